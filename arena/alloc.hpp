@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <string>
 #include <stdexcept>
+#include <algorithm>
 
 #ifdef MEGU_USE_CONSTEXPR_ALLOC
 #include <new>
@@ -56,6 +57,8 @@
 #include <windows.h>
 #else
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #endif
 
@@ -98,6 +101,31 @@ namespace megu {
 		return pg;
 	}
 
+	inline int64_t GetHugePageSize() {
+		static int64_t pg = [] {
+			int64_t pg = 0;
+#ifdef _WIN32
+			pg = static_cast<int64_t>(GetLargePageMinimum());
+#endif
+			return pg <= 0 ? (1 << 21) : pg;//default to 2mb
+		}();
+		return pg;
+	}
+
+	//how arena regions are backed, only the mmap path honors anything but NONE
+	enum class HugePages_t {
+		NONE,
+		TRANSPARENT,//huge page aligned regions advised with MADV_HUGEPAGE
+		EXPLICIT//MAP_HUGETLB / MEM_LARGE_PAGES, falls back to TRANSPARENT when the system has none to give
+	};
+
+	//when Reserve takes the first touch page faults of the regions it creates
+	enum class Prefault_t {
+		NONE,//on first use, as usual
+		SYNC,//before Reserve returns
+		ASYNC//on a helper thread, synchronously when the system can not populate pages without writing to them
+	};
+
 }
 
 namespace megu::detail {
@@ -111,7 +139,7 @@ namespace megu::detail {
 #else
 	enum class Protection_t {
 		READ = PROT_READ,
-		READ_WRITE = PROT_WRITE,
+		READ_WRITE = (PROT_READ | PROT_WRITE),
 		READ_EXEC = (PROT_READ | PROT_EXEC),
 		EXEC_READWRITE = (PROT_READ | PROT_EXEC | PROT_WRITE)
 	};
@@ -363,6 +391,389 @@ namespace megu::detail {
 	inline void SysFreeAligned(void* at, size_t bytes, size_t alignment, std::nothrow_t) noexcept {
 		return SysFreeAligned(at, bytes, alignment);
 	}
+
+	//bytes must be a multiple of GetHugePageSize(), the result is huge page aligned (when the system allows it)
+	//and is given back with SysFree
+	inline void* SysAllocHuge(size_t bytes, HugePages_t pages, std::nothrow_t)noexcept {
+		if (pages == HugePages_t::NONE) {
+			return SysAlloc(bytes, std::nothrow);
+		}
+#ifdef _WIN32
+		if (pages == HugePages_t::EXPLICIT) {
+			LPVOID ptr = VirtualAlloc(nullptr, bytes, MEM_LARGE_PAGES | MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+			if (ptr) {
+				return ptr;
+			}
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "large page allocation failed, falling back to normal pages, error " << GetLastErrorMsg() << "\n";
+#endif // MEGU_DEBUG_LOGS
+		}
+		return SysAlloc(bytes, std::nothrow);
+#else // _WIN32
+#ifdef MAP_HUGETLB
+		if (pages == HugePages_t::EXPLICIT) {
+			void* at = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+			if (at != MAP_FAILED) {
+				return at;
+			}
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "MAP_HUGETLB failed, falling back to transparent huge pages, error " << strerror(errno) << "\n";
+#endif // MEGU_DEBUG_LOGS
+		}
+#endif // MAP_HUGETLB
+		//over map by one huge page and trim both ends so the region starts on a huge page boundary
+		size_t const hp = static_cast<size_t>(GetHugePageSize());
+		char* raw = static_cast<char*>(SysAlloc(bytes + hp, std::nothrow));
+		if (raw == nullptr) {
+			return nullptr;
+		}
+		char* at = raw + ((hp - (reinterpret_cast<uintptr_t>(raw) & (hp - 1))) & (hp - 1));
+		if (at != raw) {
+			munmap(raw, static_cast<size_t>(at - raw));
+		}
+		if (size_t const tail = static_cast<size_t>((raw + bytes + hp) - (at + bytes))) {
+			munmap(at + bytes, tail);
+		}
+#ifdef MADV_HUGEPAGE
+		madvise(at, bytes, MADV_HUGEPAGE);
+#endif // MADV_HUGEPAGE
+		return at;
+#endif // _WIN32
+	}
+
+	//gives the physical pages back but keeps the range mapped and writable, the contents are lost.
+	//lazy lets the system reclaim them only under memory pressure where it supports that
+	inline void SysPurge(void* mem, size_t bytes, bool lazy)noexcept {
+#ifdef _WIN32
+		VirtualAlloc(mem, bytes, MEM_RESET, PAGE_READWRITE);
+#else // _WIN32
+#ifdef MADV_FREE
+		if (lazy && madvise(mem, bytes, MADV_FREE) == 0) {
+			return;
+		}
+#endif // MADV_FREE
+		madvise(mem, bytes, MADV_DONTNEED);
+#endif // _WIN32
+	}
+
+	//reserves address space only, the pages are inaccessible and cost nothing until committed,
+	//the reservation is given back with SysFree
+	inline void* SysReserve(size_t bytes, std::nothrow_t)noexcept {
+#ifdef _WIN32
+		LPVOID ptr = VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_NOACCESS);
+		if (!ptr) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "SysReserve failed, error " << GetLastErrorMsg() << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return nullptr;
+		}
+		return ptr;
+#else // _WIN32
+		void* at = mmap(NULL, bytes, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+		if (at == MAP_FAILED) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "mmap failed, error " << strerror(errno) << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return nullptr;
+		}
+		return at;
+#endif // _WIN32
+	}
+
+	//makes reserved pages readable and writable, mem must be page aligned
+	[[nodiscard]]
+	inline bool SysCommit(void* mem, size_t bytes, std::nothrow_t)noexcept {
+#ifdef _WIN32
+		if (!VirtualAlloc(mem, bytes, MEM_COMMIT, static_cast<DWORD>(Protection_t::READ_WRITE))) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "SysCommit failed, error " << GetLastErrorMsg() << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return false;
+		}
+#else // _WIN32
+		if (mprotect(mem, bytes, static_cast<int>(Protection_t::READ_WRITE)) != 0) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "mprotect failed, error " << strerror(errno) << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return false;
+		}
+#endif // _WIN32
+		return true;
+	}
+
+	//drops the physical pages and makes the range inaccessible again, the address space stays reserved
+	inline void SysDecommit(void* mem, size_t bytes)noexcept {
+#ifdef _WIN32
+		VirtualFree(mem, bytes, MEM_DECOMMIT);
+#else // _WIN32
+		madvise(mem, bytes, MADV_DONTNEED);
+		mprotect(mem, bytes, PROT_NONE);
+#endif // _WIN32
+	}
+
+	//resizes a mapping made by SysAlloc without copying. with target null only in place, when the address space behind it
+	//is free, otherwise the page tables are moved onto target, a SysReserve reservation of new_bytes the mapping replaces.
+	//null when the system can not (anything but linux), the mapping and the reservation are untouched then
+	[[nodiscard]]
+	inline void* SysRemap(void* mem, size_t old_bytes, size_t new_bytes, void* target, std::nothrow_t)noexcept {
+#if defined(__linux__) && defined(MREMAP_MAYMOVE) && defined(MREMAP_FIXED)
+		void* at = target == nullptr ? mremap(mem, old_bytes, new_bytes, 0)
+			: mremap(mem, old_bytes, new_bytes, MREMAP_MAYMOVE | MREMAP_FIXED, target);
+		if (at == MAP_FAILED) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "mremap failed, error " << strerror(errno) << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return nullptr;
+		}
+		return at;
+#else
+		(void)mem;
+		(void)old_bytes;
+		(void)new_bytes;
+		(void)target;
+		return nullptr;
+#endif
+	}
+
+	//faults in the pages overlapping [mem, mem + bytes) as writable without changing their contents,
+	//so it is safe on memory that is already in use. false when the system can not do it (linux < 5.14, windows)
+	[[nodiscard]]
+	inline bool SysPopulate(void* mem, size_t bytes)noexcept {
+#if !defined(_WIN32) && defined(MADV_POPULATE_WRITE)
+		uintptr_t const pg = static_cast<uintptr_t>(GetPageSize());
+		uintptr_t const first = reinterpret_cast<uintptr_t>(mem) & ~(pg - 1);
+		return madvise(reinterpret_cast<void*>(first), reinterpret_cast<uintptr_t>(mem) + bytes - first, MADV_POPULATE_WRITE) == 0;
+#else
+		(void)mem;
+		(void)bytes;
+		return false;
+#endif
+	}
+
+	//faults in the pages of [mem, mem + bytes) by writing a zero to each of them, the memory must not hold anything yet
+	inline void SysTouch(void* mem, size_t bytes)noexcept {
+		size_t const pg = static_cast<size_t>(GetPageSize());
+		char volatile* at = static_cast<char volatile*>(mem);
+		for (size_t off = 0; off < bytes; off += pg) {
+			at[off] = 0;
+		}
+		if (bytes != 0) {
+			at[bytes - 1] = 0;
+		}
+	}
+
+#ifndef _WIN32
+	//maps all of an open file or shared memory descriptor shared read/write, the descriptor may be closed afterwards
+	inline void* SysMapDescriptor(int fd, size_t& mapped_bytes, std::nothrow_t)noexcept {
+		struct stat st{};
+		if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+			return nullptr;
+		}
+		void* at = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (at == MAP_FAILED) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "mmap failed, error " << strerror(errno) << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return nullptr;
+		}
+		mapped_bytes = static_cast<size_t>(st.st_size);
+		return at;
+	}
+
+	//anonymous shared memory of bytes that can be handed to other processes as a descriptor (fork, SCM_RIGHTS),
+	//memfd_create where available, otherwise a shm_open object that is unlinked right away. -1 on failure
+	inline int SysCreateSharedDescriptor(size_t bytes)noexcept {
+#ifdef MFD_CLOEXEC
+		int fd = memfd_create("megu-shared-arena", MFD_CLOEXEC);
+#else // MFD_CLOEXEC
+		int fd = -1;
+		std::string const name = "/megu-" + std::to_string(getpid()) + "-" + std::to_string(reinterpret_cast<uintptr_t>(&fd));
+		fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd >= 0) {
+			shm_unlink(name.c_str());
+		}
+#endif // MFD_CLOEXEC
+		if (fd < 0) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "shared memory creation failed, error " << strerror(errno) << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return -1;
+		}
+		if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+#endif // _WIN32
+
+	//size of the file at path, 0 when it is missing or cannot be examined
+	inline size_t SysFileSize(char const* path)noexcept {
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA data{};
+		if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data)) {
+			return 0;
+		}
+		return static_cast<size_t>((static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow);
+#else // _WIN32
+		struct stat st{};
+		if (stat(path, &st) != 0 || st.st_size <= 0) {
+			return 0;
+		}
+		return static_cast<size_t>(st.st_size);
+#endif // _WIN32
+	}
+
+	//maps the file at path shared and read/write, creating it when missing and growing it to at least bytes,
+	//growth is sparse where the filesystem allows it. bytes 0 maps the file at the size it has, which fails for an empty one.
+	//mapped_bytes gets the mapping size, which is the file size.
+	//the mapping is given back with SysUnmapFile and keeps the file open on its own
+	inline void* SysMapFile(char const* path, size_t bytes, size_t& mapped_bytes, std::nothrow_t)noexcept {
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+			nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "CreateFile failed, error " << GetLastErrorMsg() << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return nullptr;
+		}
+		LARGE_INTEGER size{};
+		GetFileSizeEx(file, &size);
+		size_t const total = std::max(static_cast<size_t>(size.QuadPart), bytes);
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+			static_cast<DWORD>(static_cast<uint64_t>(total) >> 32), static_cast<DWORD>(total & 0xFFFFFFFFu), nullptr);
+		CloseHandle(file);
+		if (!mapping) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "CreateFileMapping failed, error " << GetLastErrorMsg() << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return nullptr;
+		}
+		void* at = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, total);
+		CloseHandle(mapping);
+		if (!at) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "MapViewOfFile failed, error " << GetLastErrorMsg() << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return nullptr;
+		}
+		mapped_bytes = total;
+		return at;
+#else // _WIN32
+		int const fd = open(path, O_RDWR | O_CREAT, 0644);
+		if (fd < 0) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "open failed, error " << strerror(errno) << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return nullptr;
+		}
+		struct stat st{};
+		if (fstat(fd, &st) != 0) {
+			close(fd);
+			return nullptr;
+		}
+		size_t const total = std::max(static_cast<size_t>(st.st_size), bytes);
+		if (static_cast<size_t>(st.st_size) < total && ftruncate(fd, static_cast<off_t>(total)) != 0) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "ftruncate failed, error " << strerror(errno) << "\n";
+#endif // MEGU_DEBUG_LOGS
+			close(fd);
+			return nullptr;
+		}
+		void* at = total == 0 ? MAP_FAILED : mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (at == MAP_FAILED) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "mmap failed, error " << strerror(errno) << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return nullptr;
+		}
+		mapped_bytes = total;
+		return at;
+#endif // _WIN32
+	}
+
+	inline void SysUnmapFile(void* mem, size_t bytes)noexcept {
+#ifdef _WIN32
+		(void)bytes;
+		UnmapViewOfFile(mem);
+#else // _WIN32
+		munmap(mem, bytes);
+#endif // _WIN32
+	}
+
+	//creates (failing when the name is taken) or opens the named shared memory object and maps it shared read/write,
+	//bytes is the size it is created with, mapped_bytes gets the size of the mapping. given back with SysUnmapFile,
+	//the object itself lives on until SysUnlinkShared
+	inline void* SysMapShared(char const* name, size_t bytes, bool create, size_t& mapped_bytes, std::nothrow_t)noexcept {
+#ifdef _WIN32
+		HANDLE mapping = nullptr;
+		if (create) {
+			mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+				static_cast<DWORD>(static_cast<uint64_t>(bytes) >> 32), static_cast<DWORD>(bytes & 0xFFFFFFFFu), name);
+			if (mapping && GetLastError() == ERROR_ALREADY_EXISTS) {
+				CloseHandle(mapping);
+				return nullptr;
+			}
+		}
+		else {
+			mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+		}
+		if (!mapping) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "file mapping failed, error " << GetLastErrorMsg() << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return nullptr;
+		}
+		void* at = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, create ? bytes : 0);
+		CloseHandle(mapping);//the view keeps it alive
+		if (!at) {
+			return nullptr;
+		}
+		MEMORY_BASIC_INFORMATION info{};
+		VirtualQuery(at, &info, sizeof(info));
+		mapped_bytes = create ? bytes : static_cast<size_t>(info.RegionSize);
+		return at;
+#else // _WIN32
+		int const fd = create ? shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600) : shm_open(name, O_RDWR, 0600);
+		if (fd < 0) {
+#ifdef MEGU_DEBUG_LOGS
+			std::cerr << "shm_open failed, error " << strerror(errno) << "\n";
+#endif // MEGU_DEBUG_LOGS
+			return nullptr;
+		}
+		if (create && ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+			close(fd);
+			shm_unlink(name);
+			return nullptr;
+		}
+		void* at = SysMapDescriptor(fd, mapped_bytes, std::nothrow);
+		close(fd);
+		if (at == nullptr && create) {
+			shm_unlink(name);
+		}
+		return at;
+#endif // _WIN32
+	}
+
+	inline void SysUnlinkShared(char const* name)noexcept {
+#ifdef _WIN32
+		(void)name;//the mapping goes away with its last view
+#else // _WIN32
+		shm_unlink(name);
+#endif // _WIN32
+	}
+
+	//writes the dirty pages of a file mapping back, async only schedules the writeback
+	inline bool SysFlushFile(void* mem, size_t bytes, bool async)noexcept {
+#ifdef _WIN32
+		(void)async;
+		return FlushViewOfFile(mem, bytes) != 0;
+#else // _WIN32
+		return msync(mem, bytes, async ? MS_ASYNC : MS_SYNC) == 0;
+#endif // _WIN32
+	}
 #endif
 
 	
@@ -12,12 +12,244 @@
 #define MEGU_DEBUG_LOGS
 #endif
 #include "alloc.hpp"
+#include "page_map.hpp"
+#include "region_cache.hpp"
+#include "heap_profiler.hpp"
 #include <vector>
 #include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstring>
 #include <sstream>
+#include <limits>
+#include <type_traits>
+#if __cplusplus >= 202002L
+#include <bit>
+#endif
 
 namespace megu {
+	//decides the capacity of every new region an arena creates,
+	//the result is never smaller than the allocation that triggered the growth
+	struct GrowthPolicy {
+		struct Request {
+			std::size_t bytes;//size of the allocation that did not fit anywhere
+			std::size_t last_capacity;//capacity of the previously created region, 0 for the first one
+			std::size_t num_regions;
+		};
+		using Callback = std::size_t(*)(Request const&, void* user)noexcept;
+
+		//every region is step bytes, this is what arenas always did
+		static constexpr GrowthPolicy Fixed(std::size_t step = (1 << 12))noexcept {
+			return GrowthPolicy(kind_t::fixed, step, step, 1, nullptr, nullptr);
+		}
+		//starts at initial and multiplies by factor on every new region until max_capacity
+		static constexpr GrowthPolicy Geometric(std::size_t initial = (1 << 12),
+			std::size_t max_capacity = (1 << 26),
+			std::size_t factor = 2)noexcept {
+			return GrowthPolicy(kind_t::geometric, initial, max_capacity, factor, nullptr, nullptr);
+		}
+		static constexpr GrowthPolicy Custom(Callback fn, void* user = nullptr)noexcept {
+			return GrowthPolicy(kind_t::custom, 0, 0, 1, fn, user);
+		}
+
+		[[nodiscard]]
+		constexpr std::size_t next_capacity(std::size_t bytes, std::size_t last_capacity, std::size_t num_regions)const noexcept {
+			std::size_t cap = initial_;
+			switch (kind_) {
+			case kind_t::fixed:
+				break;
+			case kind_t::geometric:
+				if (last_capacity != 0) {
+					cap = last_capacity >= max_ / factor_ ? max_ : std::max(initial_, last_capacity * factor_);
+				}
+				break;
+			case kind_t::custom:
+				cap = fn_(Request{ bytes, last_capacity, num_regions }, user_);
+				break;
+			}
+			return std::max(cap, bytes);
+		}
+
+	private:
+		enum class kind_t : uint8_t {
+			fixed,
+			geometric,
+			custom
+		};
+
+		constexpr GrowthPolicy(kind_t kind, std::size_t initial, std::size_t max_cap, std::size_t factor, Callback fn, void* user)noexcept
+			:kind_(kind), initial_(initial), max_(max_cap), factor_(factor < 1 ? 1 : factor), fn_(fn), user_(user) {}
+
+		kind_t kind_;
+		std::size_t initial_;
+		std::size_t max_;
+		std::size_t factor_;
+		Callback fn_;
+		void* user_;
+	};
+
+	//compile time choices for BasicArena, the defaults make up Arena.
+	//the lock policy is anything with lock()/unlock() (std::mutex, a spin lock), NoLock compiles the locking away
+	struct NoLock {
+		constexpr void lock()noexcept {}
+		constexpr void unlock()noexcept {}
+	};
+	//any block can be given back with Deallocate/Reallocate, regions count their blocks to know when they are empty
+	struct IndividualFree {
+		static constexpr bool counted = true;
+	};
+	//Deallocate does nothing and Reallocate always copies, memory comes back only with ClearArena/Rewind/FreeArena,
+	//so nothing is counted and slab pools are not used
+	struct BulkFree {
+		static constexpr bool counted = false;
+	};
+	//alignment is an argument of every call
+	struct DynamicAlign {
+		static constexpr std::size_t default_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+		static constexpr std::size_t min_alignment = 1;
+	};
+	//every block is aligned to at least Align, a constant the alignment fix-up folds into
+	template<std::size_t Align>
+	struct FixedAlign {
+		static_assert(Align != 0 && (Align & (Align - 1)) == 0, "alignment must be a power of two");
+		static constexpr std::size_t default_alignment = Align;
+		static constexpr std::size_t min_alignment = Align;
+	};
+
+	namespace detail {
+		class ArenaBase;
+
+		//scoped lock over a lock policy, nothing at all for NoLock so unlocked arenas stay usable in constant evaluation
+		template<typename Lock>
+		struct lock_guard_t {
+			explicit lock_guard_t(Lock& lock)
+				:lock_(lock) {
+				lock_.lock();
+			}
+			~lock_guard_t() {
+				lock_.unlock();
+			}
+			lock_guard_t(lock_guard_t const&) = delete;
+			lock_guard_t& operator=(lock_guard_t const&) = delete;
+
+			Lock& lock_;
+		};
+		template<>
+		struct lock_guard_t<NoLock> {
+			constexpr explicit lock_guard_t(NoLock&)noexcept {}
+		};
+
+		//arena resident record of objects whose destructors run when the arena is cleared,
+		//it sits right in front of the objects it describes
+		struct dtor_node_t {
+			void(*dtor_)(void*, std::size_t)noexcept;
+			void* objs_;
+			std::size_t count_;
+			dtor_node_t* next_;
+		};
+
+		struct arena_position_t {
+			void* region_;//cursor region at the time, null if there was none
+			std::size_t offset_;
+			std::size_t seq_;//regions numbered from seq_ on were created afterwards
+			bool active_;
+		};
+	}
+
+	//checkpoint returned by Arena::Mark, only meaningful to the arena that made it
+	class ArenaMark {
+	public:
+		constexpr ArenaMark()noexcept
+			:at_{ nullptr, 0, 0, false }, allocs_(0), prev_{ nullptr, 0, 0, false }, dtors_(nullptr), samples_(0) {}
+	private:
+		friend class detail::ArenaBase;
+
+		detail::arena_position_t at_;
+		uint32_t allocs_;
+		detail::arena_position_t prev_;//mark that was the youngest before this one
+		detail::dtor_node_t* dtors_;//destructors registered after the mark run on rewind
+		std::size_t samples_;//heap profiler samples taken after the mark are dropped on rewind
+	};
+
+	//snapshot returned by Arena::GetStats, the counters are cumulative over the arena's lifetime so a scraper
+	//takes differences between two snapshots, the rest describes the arena as it is now.
+	//blocks served from slab pools show up as the slabs they are carved from
+	struct ArenaStats {
+		std::size_t bytes_requested;//sizes asked for, in place growth counts the difference
+		std::size_t bytes_padding;//lost to aligning blocks inside their regions
+		std::size_t slow_path_hits;//allocations the cursor region could not serve
+		std::size_t system_allocations;//regions and large blocks mapped from the system, not the region cache
+		std::size_t system_frees;
+		std::size_t num_regions;
+		std::size_t num_large;
+		std::size_t peak_regions;//regions and large blocks at the same time
+		std::size_t bytes_reserved;//in use up to the bump position of every region and large block
+		std::size_t bytes_capacity;//mapped for regions and large blocks
+		std::size_t peak_bytes_capacity;
+		double fragmentation;//share of the capacity that is not reserved, 0 with nothing mapped
+
+		//one flat object, the keys are the member names
+		std::string ToJson()const {
+			std::ostringstream ss;
+			ss << "{\"bytes_requested\":" << bytes_requested
+				<< ",\"bytes_padding\":" << bytes_padding
+				<< ",\"slow_path_hits\":" << slow_path_hits
+				<< ",\"system_allocations\":" << system_allocations
+				<< ",\"system_frees\":" << system_frees
+				<< ",\"num_regions\":" << num_regions
+				<< ",\"num_large\":" << num_large
+				<< ",\"peak_regions\":" << peak_regions
+				<< ",\"bytes_reserved\":" << bytes_reserved
+				<< ",\"bytes_capacity\":" << bytes_capacity
+				<< ",\"peak_bytes_capacity\":" << peak_bytes_capacity
+				<< ",\"fragmentation\":" << fragmentation << "}";
+			return ss.str();
+		}
+	};
+
 	namespace detail {
+		constexpr uintptr_t _alignment_shift(const uintptr_t ptr, const std::size_t aling)noexcept {
+			return ((~(ptr)) + 1) & (aling - 1);
+		}
+		constexpr std::ptrdiff_t alignment_offset(const std::size_t alignment, const void* ptr)noexcept {
+			const auto off = _alignment_shift(reinterpret_cast<uintptr_t>(ptr), alignment);
+			return off == alignment ? 0 : off;
+		}
+
+		constexpr unsigned floor_log2(std::size_t n)noexcept {//n must be non zero
+#if __cplusplus >= 202002L
+			return static_cast<unsigned>(std::bit_width(n)) - 1;
+#else
+			unsigned r = 0;
+			while (n >>= 1) {
+				++r;
+			}
+			return r;
+#endif
+		}
+
+		constexpr unsigned lowest_set_bit(uint64_t n)noexcept {//n must be non zero
+#if __cplusplus >= 202002L
+			return static_cast<unsigned>(std::countr_zero(n));
+#else
+			unsigned r = 0;
+			while (!(n & 1)) {
+				n >>= 1;
+				++r;
+			}
+			return r;
+#endif
+		}
+
+		//false before C++20, code that has to run during constant evaluation then simply is not
+		constexpr bool constant_evaluated()noexcept {
+#if __cplusplus >= 202002L
+			return std::is_constant_evaluated();
+#else
+			return false;
+#endif
+		}
+
 		struct region_t {
 			constexpr region_t(region_t const& other)noexcept = delete;
 			constexpr region_t& operator=(region_t const& other)noexcept = delete;
@@ -32,22 +264,37 @@ namespace megu {
 				return *this;
 			}
 			MEGU_CONSTEXPR region_t(std::size_t capacity = (1 << 12),//assume page size is 4kb
-				std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept
+				std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+				HugePages_t pages = HugePages_t::NONE)noexcept
 				:cap_(capacity), size_(0), chunk_(nullptr), alignment_(align),
-				allocs_(0)
+				allocs_(0), pages_(HugePages_t::NONE)
 			{
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+				std::size_t const hp = static_cast<std::size_t>(GetHugePageSize());
+				if (pages != HugePages_t::NONE && align <= hp) {//round up so whole huge pages back the region
+					pages_ = pages;
+					cap_ = (capacity + hp - 1) & ~(hp - 1);
+					chunk_ = static_cast<char*>(detail::SysAllocHuge(cap_, pages, std::nothrow));
+					return;
+				}
+#endif //MEGU_USE_CONSTEXPR_ALLOC
 				if (!use_default_align()) {
-					chunk_ = static_cast<char*>(detail::SysAllocAligned(capacity, align, std::nothrow));
+					chunk_ = static_cast<char*>(detail::SysAllocAligned(capacity, chunk_alignment(), std::nothrow));
 				}
 				else {
 					chunk_ = static_cast<char*>(detail::SysAlloc(cap_, std::nothrow));
 				}
 			}
 
+			//takes over a chunk mapped by SysAlloc/SysAllocHuge for a region of the same kind
+			constexpr region_t(void* chunk, std::size_t capacity, std::size_t align, HugePages_t pages)noexcept
+				:cap_(capacity), size_(0), alignment_(align), chunk_(static_cast<char*>(chunk)),
+				allocs_(0), pages_(pages) {}
+
 			~region_t() {
 				if (chunk_ != nullptr) {
-					if (!use_default_align()) {
-						detail::SysFreeAligned(chunk_, cap_, alignment_, std::nothrow);
+					if (!use_default_align() && pages_ == HugePages_t::NONE) {
+						detail::SysFreeAligned(chunk_, cap_, chunk_alignment(), std::nothrow);
 					}
 					else {
 						detail::SysFree(chunk_, cap_, std::nothrow);
@@ -128,15 +375,55 @@ namespace megu {
 #endif
 				bool use_default_align()const noexcept {
 #ifdef MEGU_USE_CONSTEXPR_ALLOC  
-				return alignment_ <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+				return chunk_alignment() <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
 #else
 				return alignment_ <= GetPageSize();
 #endif // MEGU_USE_CONSTEXPR_ALLOC
 			}
 
+			//operator new chunks made outside constant evaluation start on a page map page so no two regions share one,
+			//the mmap path is page aligned anyway
+			[[nodiscard]]
+			constexpr std::size_t chunk_alignment()const noexcept {
+#ifdef MEGU_USE_CONSTEXPR_ALLOC
+				if (!constant_evaluated()) {
+					return std::max(alignment_, page_map_t::page_size);
+				}
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+				return alignment_;
+			}
+
 			constexpr uint32_t& nallocations()noexcept {
 				return allocs_;
 			}
+			constexpr uint32_t nallocations()const noexcept {
+				return allocs_;
+			}
+
+			[[nodiscard]]
+			constexpr HugePages_t pages()const noexcept {
+				return pages_;
+			}
+
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+			//plain SysAlloc mappings can be resized with SysRemap
+			[[nodiscard]]
+			bool remappable()const noexcept {
+				return chunk_ != nullptr && pages_ == HugePages_t::NONE && use_default_align();
+			}
+			//resizes the chunk to capacity bytes without copying, in place or onto the reservation at, see SysRemap.
+			//false leaves the region as it was
+			[[nodiscard]]
+			bool remap(std::size_t capacity, void* at = nullptr)noexcept {
+				at = detail::SysRemap(chunk_, cap_, capacity, at, std::nothrow);
+				if (at == nullptr) {
+					return false;
+				}
+				chunk_ = static_cast<char*>(at);
+				cap_ = capacity;
+				return true;
+			}
+#endif //MEGU_USE_CONSTEXPR_ALLOC
 
 		protected:
 			constexpr void private_move(region_t&& other) {
@@ -149,6 +436,7 @@ namespace megu {
 				alignment_ = other.alignment_;
 				allocs_ = other.allocs_;
 				other.allocs_ = 0;
+				pages_ = other.pages_;
 			}
 		private:
 
@@ -158,210 +446,942 @@ namespace megu {
 			std::size_t alignment_;
 			char* chunk_;
 			uint32_t allocs_;
+			HugePages_t pages_;//regions backed by huge pages are always mapped, whatever their alignment
 		};
 
-		class ArenaBase {
-		public:
-			constexpr std::size_t NumRegions()noexcept {
-				return regs_.size();
+		//region whose bump pointer and allocation count can be advanced by many threads at once
+		//chunk ownership is delegated to a plain region_t whose own size_ stays unused
+		struct atomic_region_t {
+			atomic_region_t(atomic_region_t const&) = delete;
+			atomic_region_t(atomic_region_t&&) = delete;
+			atomic_region_t& operator=(atomic_region_t const&) = delete;
+			atomic_region_t& operator=(atomic_region_t&&) = delete;
+
+			atomic_region_t(std::size_t capacity, std::size_t align, HugePages_t pages = HugePages_t::NONE)noexcept
+				:storage_(capacity, align, pages), size_(0), allocs_(0) {}
+			atomic_region_t(void* chunk, std::size_t capacity, std::size_t align, HugePages_t pages)noexcept
+				:storage_(chunk, capacity, align, pages), size_(0), allocs_(0) {}
+
+			[[nodiscard]]
+			bool is_valid()const noexcept {
+				return storage_.is_valid();
 			}
-			std::string DumpUsage() {
-				return regs_.dump_usage(); 
+
+			[[nodiscard]]
+			bool in_region(void const* ptr)const noexcept {//bounded by capacity since size_ may be rewound concurrently
+				return ptr >= storage_.data() && ptr < storage_.end();
 			}
 
-		protected:
-			constexpr ArenaBase(std::size_t min_region_capacity = (1 << 12))
-				:min_cap_(min_region_capacity), regs_() {}
+			[[nodiscard]]
+			void* try_reserve(std::size_t nbytes, std::size_t align)noexcept {
+				//count the reservation before publishing it so a concurrent free of the last block
+				//can never rewind the region underneath us
+				allocs_.fetch_add(1);
+				std::size_t old = size_.load(std::memory_order_relaxed);
+				for (;;) {
+					char* const at = begin_at(old);
+					std::size_t const aligned = alignment_offset(align, at);
+					std::size_t const nsize = old + aligned + nbytes;
+					if (nsize > capacity()) {
+						allocs_.fetch_sub(1);
+						return nullptr;
+					}
+					if (size_.compare_exchange_weak(old, nsize)) {
+						return at + aligned;
+					}
+				}
+			}
 
-			MEGU_CONSTEXPR void FreeUnusedRegions()noexcept {
-				regs_.remove_unused();
+			[[nodiscard]]
+			bool try_resize_back(void const* mem, std::size_t olds, std::size_t news)noexcept {
+				std::size_t end = offset_of(mem) + olds;
+				std::size_t const nend = end - olds + news;
+				if (nend > capacity()) {
+					return false;
+				}
+				return size_.compare_exchange_strong(end, nend);
 			}
-			MEGU_CONSTEXPR void FreeArena()noexcept {
-				regs_.free_all();
+
+			void free_reservation(void const* mem, std::size_t nbytes)noexcept {
+				if (allocs_.fetch_sub(1) == 1) {
+					//last live block, rewind the whole region unless someone reserved in the meantime
+					std::size_t sz = size_.load();
+					if (allocs_.load() == 0) {
+						size_.compare_exchange_strong(sz, 0);
+					}
+					return;
+				}
+				//only succeeds if mem is still the last reservation in the region
+				std::size_t end = offset_of(mem) + nbytes;
+				size_.compare_exchange_strong(end, end - nbytes);
 			}
-			MEGU_CONSTEXPR void ClearArena()noexcept {
-				regs_.clear_all();
+
+			void clear()noexcept {//callers guarantee exclusive access
+				allocs_.store(0, std::memory_order_relaxed);
+				size_.store(0, std::memory_order_relaxed);
 			}
+
 			[[nodiscard]]
-			MEGU_CONSTEXPR std::vector<void*> ReleaseArena() {
-				return regs_.release_all();
+			void* release()noexcept {
+				clear();
+				return storage_.release();
 			}
+
 			[[nodiscard]]
-			MEGU_CONSTEXPR void* ReleaseRegionContaining(void const* mem)noexcept {
-				return regs_.release_region_containing(mem);
+			void* data()const noexcept {
+				return storage_.data();
 			}
-
 			[[nodiscard]]
-			MEGU_CONSTEXPR void* alloc_nothrow(std::size_t bytes, std::size_t align)noexcept {
-				return regs_.try_alloc(bytes, align, min_cap_);
+			std::size_t size()const noexcept {
+				return size_.load(std::memory_order_relaxed);
 			}
 			[[nodiscard]]
-			MEGU_CONSTEXPR void* realloc_nothrow(void* mem, std::size_t olds, std::size_t news, std::size_t align)noexcept {
-				return regs_.try_realloc(mem, olds, news, align, min_cap_);
+			std::size_t capacity()const noexcept {
+				return storage_.capacity();
 			}
-
-			MEGU_CONSTEXPR void dealloc(void* mem, std::size_t bytes, std::size_t align)noexcept {
-				return regs_.dealloc(mem, bytes, align);
+			[[nodiscard]]
+			std::size_t alignment()const noexcept {
+				return storage_.alignment();
 			}
-
-		private:
-			static constexpr uintptr_t _alignment_shift(const uintptr_t ptr, const std::size_t aling)noexcept {
-				return ((~(ptr)) + 1) & (aling - 1);
+			[[nodiscard]]
+			HugePages_t pages()const noexcept {
+				return storage_.pages();
 			}
-			static constexpr std::ptrdiff_t alignment_offset(const std::size_t alignment, const void* ptr)noexcept {
-				const auto off = _alignment_shift(reinterpret_cast<uintptr_t>(ptr), alignment);
-				return off == alignment ? 0 : off;
+			[[nodiscard]]
+			uint32_t nallocations()const noexcept {
+				return allocs_.load(std::memory_order_relaxed);
+			}
+			[[nodiscard]]
+			bool is_empty()const noexcept {
+				return size() == 0 || nallocations() == 0;
 			}
-			struct region_list_t {
-				constexpr region_list_t(region_list_t const&) = delete;
-				constexpr region_list_t(region_list_t&&) = delete;
-				constexpr region_list_t& operator=(region_list_t const&) = delete;
-				constexpr region_list_t& operator=(region_list_t&&) = delete;
-
-				struct region_node_t : public detail::region_t {
-					using detail::region_t::region_t;
-					constexpr region_node_t(region_node_t const&) = delete;
-					constexpr region_node_t(region_node_t&&) = delete;
-					constexpr region_node_t& operator=(region_node_t const&) = delete;
-					constexpr region_node_t& operator=(region_node_t&&) = delete;
-
-					region_node_t* next_{ nullptr };
-				};
 
+			atomic_region_t* next_{ nullptr };//immutable once the node is published
+			atomic_region_t* prev_{ nullptr };//written once by whoever publishes the node in front of this one
+			void const* owner_{ nullptr };//owner check for page map lookups
 
-				constexpr region_list_t()
-					:size_(0), head_(nullptr) {}
+		private:
+			char* begin_at(std::size_t offset)const noexcept {
+				return static_cast<char*>(storage_.data()) + offset;
+			}
+			std::size_t offset_of(void const* mem)const noexcept {
+				return static_cast<std::size_t>(static_cast<char const*>(mem) - static_cast<char const*>(storage_.data()));
+			}
 
-				~region_list_t() {
-					free_all();
-				}
+			region_t storage_;
+			std::atomic<std::size_t> size_;
+			std::atomic<uint32_t> allocs_;
+		};
 
-				MEGU_CONSTEXPR void dealloc(void const* mem, std::size_t nbytes, std::size_t align)noexcept {
-					if (!head_) {
-						return;
-					}
-					if (head_->in_region(mem)) {
-						return free_reservation_in_region(head_, mem, nbytes, align);
-					}
-					auto node = prev_node_containing(mem);
-					if (!node) {
-						return;
-					}
-					return free_reservation_in_region(node->next_, mem, nbytes, align);
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+		//faults in the data of a region nobody allocates from yet. ASYNC populates on a detached thread, which stays
+		//harmless even if the region is in use or gone by then, so it needs SysPopulate and otherwise runs here like SYNC
+		inline void prefault_region(void* mem, std::size_t bytes, Prefault_t prefault)noexcept {
+			if (prefault == Prefault_t::NONE) {
+				return;
+			}
+			if (prefault == Prefault_t::ASYNC && SysPopulate(nullptr, 0)) {
+				try {
+					std::thread([mem, bytes] { (void)SysPopulate(mem, bytes); }).detach();
+					return;
 				}
+				catch (...) {}
+			}
+			if (!SysPopulate(mem, bytes)) {
+				SysTouch(mem, bytes);
+			}
+		}
+#endif //MEGU_USE_CONSTEXPR_ALLOC
 
-				MEGU_CONSTEXPR void* try_alloc(std::size_t nbytes, std::size_t align,
-					std::size_t min_cap)noexcept {
-					if (is_empty()) {
-						auto* node = push_front(std::max(nbytes, min_cap), align);
+		//creates and destroys region nodes, the node is a separate heap object around its chunk.
+		//chunks cached by a RegionCache are tried before the system and are given back to it on destruction
+		struct region_factory_t {
+			template<typename Node>
+			[[nodiscard]]
+			static MEGU_CONSTEXPR Node* create(std::size_t capacity, std::size_t align,
+				HugePages_t pages, RegionCache* cache, bool& from_system)noexcept {
+				from_system = true;
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+				if (cache != nullptr && RegionCache::recyclable(align, pages)) {
+					std::size_t cap = 0;
+					if (void* chunk = cache->take(capacity, pages, cap)) {
+						Node* node = new(std::nothrow) Node(chunk, cap, align, pages);
 						if (node == nullptr) {
-							return nullptr;
+							cache->give(chunk, cap, pages);
 						}
-						return reserve_region(node, nbytes, align);
-					}
-					region_node_t* r = head_; 
-					if (fits_in_region(r, nbytes, align)) { 
-						return reserve_region(r, nbytes, align);
-					}
-					else {
-						for (; r->next_ != nullptr; r = r->next_) { 
-							if (fits_in_region(r, nbytes, align)) { 
-								return reserve_region(r, nbytes, align); 
-							} 
-						} 
-					}
-					r = push_next(r, std::max(nbytes, min_cap), align);
-					if (r == nullptr) {
-						return nullptr;
+						from_system = false;
+						return node;
 					}
-					return reserve_region(r, nbytes, align);
 				}
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+				return new(std::nothrow) Node(capacity, align, pages);
+			}
 
-				MEGU_CONSTEXPR void* try_realloc(void* mem, std::size_t olds, std::size_t news, std::size_t align,
-					std::size_t min_cap)noexcept {
-					if (mem == nullptr) {//if realloc was called in place of alloc
-						return try_alloc(news, align, min_cap);
-					}
-					if (news == olds) {//weird case but whatever
-						return mem;
-					}
-					if (is_empty()) {//if the memory is not part of this arena because this arena is empty
-						return nullptr;
-					}
-					//find the region
-					auto* region = head_->in_region(mem) ? head_ : prev_node_containing(mem);
-					if (region == nullptr) {//if memory is not part of this arena return null
-						return nullptr;
-					}
-					if (0 == news) {//if realloc to 0 free
-						free_reservation_in_region(region, mem, olds, align);
-						return nullptr;
-					}
-					std::ptrdiff_t const d = news - olds;
-					// if shrinking or growing and is .back() resize and return
-					if (region->begin() - olds == mem && region->begin() + d < region->end()) {
-						region->size() += d;
-						return mem;
-					}
-					if (d < 0) {//if its shrinking and not .back() return as is
-						return mem;
-					}
-
-					//allocate a new region if it doesnt fit
-					auto* newreg = try_alloc(news, align, min_cap);
-					if (!newreg) {
-						return nullptr;
-					}
-					// if we are not using constexpr do a memcpy
+			//returns whether the chunk went back to the system
+			template<typename Node>
+			static MEGU_CONSTEXPR bool destroy(Node* node, RegionCache* cache)noexcept {
 #ifndef MEGU_USE_CONSTEXPR_ALLOC
-					std::memcpy(newreg, mem, olds);
-#else //MEGU_USE_CONSTEXPR_ALLOC
-				//otherwise do a normal copy
-					char* newreg_ = reinterpret_cast<char*>(newreg);
-					char const* oldreg_ = reinterpret_cast<char const*>(mem);
-					std::copy(oldreg_, oldreg_ + olds, newreg_);
-#endif //MEGU_USE_CONSTEXPR_ALLOC
-					free_reservation_in_region(region, mem, olds, align);
-					return newreg;
+				if (cache != nullptr && node->is_valid() && RegionCache::recyclable(node->alignment(), node->pages())) {
+					std::size_t const cap = node->capacity();
+					HugePages_t const pages = node->pages();
+					cache->give(node->release(), cap, pages);
+					delete node;
+					return false;
 				}
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+				bool const valid = node->is_valid();
+				delete node;
+				return valid;
+			}
 
-				MEGU_CONSTEXPR void* release_region_containing(void const* mem)noexcept {
-					if (is_empty()) {
-						return nullptr;
-					}
-					void* data = nullptr;
-					if (head_->in_region(mem)) {
-						data = head_->release();
-						remove_head();
-					}
-					else {
-						auto* prev = prev_node_containing(mem);
-						if (prev == nullptr) {
-							return nullptr;
-						}
-						data = prev->next_->release();
-						remove_next(prev);
-					}
-					return data;
-				}
+			//hands the region's memory to the caller and disposes of the node
+			template<typename Node>
+			[[nodiscard]]
+			static MEGU_CONSTEXPR void* release(Node* node)noexcept {
+				void* data = node->release();
+				destroy(node, nullptr);
+				return data;
+			}
+		};
 
-				MEGU_CONSTEXPR std::vector<void*> release_all() {
-					std::vector<void*> vec;
-					vec.reserve(size_);
-					for (region_node_t* h = head_; h != nullptr; h = h->next_) {
-						vec.push_back(h->release());
-					}
-					free_all();
-					return vec;
-				}
+		//fixed size classes with intrusive free lists for small blocks, a class bumps through its current slab
+		//and only asks its arena for a new one when the slab and the free list are both exhausted.
+		//classes are 16 byte steps up to 128 and four steps per power of two above that, up to 1024
+		struct slab_pools_t {
+			static constexpr unsigned nclasses = 20;
+			static constexpr std::size_t max_size = 1024;
+			static constexpr std::size_t slab_size = (1 << 14);
+			static constexpr std::size_t alignment = 16;
+
+			struct free_block_t {
+				free_block_t* next_;
+			};
+			struct class_t {
+				free_block_t* free_;
+				char* bump_;
+				char* end_;
+			};
 
-				MEGU_CONSTEXPR void clear_all()noexcept {
-					for (region_node_t* h = head_; h != nullptr; h = h->next_) {
-						h->clear();
-					}
+			[[nodiscard]]
+			static constexpr bool pooled(std::size_t nbytes, std::size_t align)noexcept {
+				return nbytes != 0 && nbytes <= max_size && align <= alignment;
+			}
+			[[nodiscard]]
+			static constexpr unsigned class_of(std::size_t nbytes)noexcept {
+				if (nbytes <= 128) {
+					return static_cast<unsigned>((nbytes + 15) / 16 - 1);
 				}
-				MEGU_CONSTEXPR void free_all()noexcept {
-					free_nodes();
+				unsigned const k = floor_log2(nbytes - 1);
+				return 8 + (k - 7) * 4 + static_cast<unsigned>((nbytes - 1) >> (k - 2)) - 4;
+			}
+			[[nodiscard]]
+			static constexpr std::size_t class_size(unsigned c)noexcept {
+				if (c < 8) {
+					return (c + 1) * 16;
+				}
+				unsigned const k = 7 + (c - 8) / 4;
+				return std::size_t(4 + (c - 8) % 4 + 1) << (k - 2);
+			}
+
+			[[nodiscard]]
+			void* pop(unsigned c)noexcept {
+				class_t& cls = classes_[c];
+				if (free_block_t* b = cls.free_) {
+					cls.free_ = b->next_;
+					return b;
+				}
+				if (cls.bump_ != cls.end_) {
+					void* mem = cls.bump_;
+					cls.bump_ += class_size(c);
+					return mem;
+				}
+				return nullptr;
+			}
+			void push(unsigned c, void* mem)noexcept {
+				classes_[c].free_ = ::new(mem) free_block_t{ classes_[c].free_ };
+			}
+			void refill(unsigned c, void* slab)noexcept {
+				class_t& cls = classes_[c];
+				cls.bump_ = static_cast<char*>(slab);
+				cls.end_ = cls.bump_ + slab_size / class_size(c) * class_size(c);
+			}
+			//forgets every slab, the memory itself belongs to the arena's regions
+			constexpr void reset()noexcept {
+				for (auto& cls : classes_) {
+					cls = class_t{ nullptr, nullptr, nullptr };
+				}
+			}
+
+			bool enabled_{ false };
+			class_t classes_[nclasses]{};
+		};
+
+		class ArenaBase {
+		public:
+			constexpr std::size_t NumRegions()noexcept {
+				return regs_.size();
+			}
+			//regions ever requested from the system, each one is a SysAlloc call
+			constexpr std::size_t NumSystemAllocations()const noexcept {
+				return regs_.sys_allocs();
+			}
+			constexpr std::size_t NumSystemFrees()const noexcept {
+				return regs_.sys_frees();
+			}
+			std::string DumpUsage() {
+				return regs_.dump_usage(); 
+			}
+			//cheap enough to scrape often, it reads the counters and walks the region headers once without formatting anything
+			[[nodiscard]]
+			MEGU_CONSTEXPR ArenaStats GetStats()const noexcept {
+				return regs_.stats();
+			}
+
+			constexpr void SetGrowthPolicy(GrowthPolicy growth)noexcept {
+				growth_ = growth;
+			}
+			[[nodiscard]]
+			constexpr GrowthPolicy const& GetGrowthPolicy()const noexcept {
+				return growth_;
+			}
+
+			//applies to regions created from now on, huge page regions are rounded up to GetHugePageSize()
+			constexpr void SetHugePages(HugePages_t pages)noexcept {
+				regs_.set_pages(pages);
+			}
+			[[nodiscard]]
+			constexpr HugePages_t GetHugePages()const noexcept {
+				return regs_.pages();
+			}
+
+			//regions freed from now on are handed to cache and new ones are taken from it first,
+			//null gives them straight back to the system
+			constexpr void SetRegionCache(RegionCache* cache)noexcept {
+				regs_.set_cache(cache);
+			}
+			[[nodiscard]]
+			constexpr RegionCache* GetRegionCache()const noexcept {
+				return regs_.cache();
+			}
+
+			//blocks of at least threshold bytes get a system allocation of their own outside the regions, so they are never
+			//scanned for small allocations and Deallocate gives them back to the system (or the region cache) at once.
+			//0 (the default) does this for blocks of 128KiB or more that are bigger than the region the growth policy
+			//would make next, SIZE_MAX never does
+			constexpr void SetLargeThreshold(std::size_t threshold)noexcept {
+				regs_.set_large_threshold(threshold);
+			}
+			[[nodiscard]]
+			constexpr std::size_t GetLargeThreshold()const noexcept {
+				return regs_.large_threshold();
+			}
+			//live blocks on the large path, they are not counted by NumRegions
+			[[nodiscard]]
+			constexpr std::size_t NumLargeAllocations()const noexcept {
+				return regs_.nlarge();
+			}
+
+			//serves blocks of up to 1024 bytes with default alignment from size class free lists so freed blocks
+			//are reused right away, pooled blocks are not reclaimed by Rewind, only by ClearArena/FreeArena.
+			//switch only while nothing is allocated, blocks must be freed under the mode they were allocated in
+			constexpr void SetSlabPools(bool enabled)noexcept {
+				pools_.enabled_ = enabled;
+				pools_.reset();
+			}
+			[[nodiscard]]
+			constexpr bool GetSlabPools()const noexcept {
+				return pools_.enabled_;
+			}
+
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+			//samples the blocks handed out from now on into profiler, null stops. what was sampled before is dropped.
+			//while samples are alive every Deallocate looks its block up, unprofiled arenas pay a null check per allocation.
+			//blocks given away with ReleaseRegionContaining stay in the profile until their address is reused
+			void SetHeapProfiler(HeapProfiler* profiler)noexcept {
+				sampler_.set_profiler(profiler);
+			}
+			[[nodiscard]]
+			HeapProfiler* GetHeapProfiler()const noexcept {
+				return sampler_.profiler();
+			}
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+
+		protected:
+			constexpr ArenaBase(std::size_t min_region_capacity = (1 << 12))
+				:regs_(), growth_(GrowthPolicy::Fixed(min_region_capacity)), dtors_(nullptr), pools_() {}
+			constexpr ArenaBase(GrowthPolicy growth)
+				:regs_(), growth_(growth), dtors_(nullptr), pools_() {}
+
+			~ArenaBase() {
+				run_destructors_until(nullptr);
+			}
+
+			MEGU_CONSTEXPR void FreeUnusedRegions()noexcept {
+				regs_.remove_unused();
+			}
+			//makes sure at least nbytes sit in regions nothing is allocated from, creating one region for the difference,
+			//so the allocations that follow neither call into the system nor, with prefault, take first touch page faults.
+			//the regions are given back by FreeUnusedRegions like any other empty one, false if one could not be created
+			MEGU_CONSTEXPR bool Reserve(std::size_t nbytes, Prefault_t prefault = Prefault_t::NONE)noexcept {
+				return regs_.reserve(nbytes, growth_, prefault);
+			}
+			MEGU_CONSTEXPR void FreeArena()noexcept {
+				run_destructors_until(nullptr);
+				pools_.reset();
+				forget_samples(0);
+				regs_.free_all();
+			}
+			MEGU_CONSTEXPR void ClearArena()noexcept {
+				run_destructors_until(nullptr);
+				pools_.reset();
+				forget_samples(0);
+				regs_.clear_all();
+			}
+			[[nodiscard]]
+			MEGU_CONSTEXPR ArenaMark Mark()noexcept {
+				ArenaMark m;
+				m.prev_ = regs_.mark(m.at_, m.allocs_);
+				m.dtors_ = dtors_;
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+				m.samples_ = sampler_.seq();
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+				return m;
+			}
+			MEGU_CONSTEXPR void Rewind(ArenaMark const& m)noexcept {
+				run_destructors_until(m.dtors_);
+				pools_.reset();//slabs carved after the mark are about to be rewound
+				forget_samples(m.samples_);
+				regs_.rewind(m.at_, m.allocs_, m.prev_);
+			}
+			//every pointer is the start of a region's chunk and is freed the way the region would have freed it,
+			//under MEGU_USE_CONSTEXPR_ALLOC chunks made at runtime are aligned to at least page_map_t::page_size
+			[[nodiscard]]
+			MEGU_CONSTEXPR std::vector<void*> ReleaseArena() {
+				run_destructors_until(nullptr);
+				pools_.reset();
+				forget_samples(0);
+				return regs_.release_all();
+			}
+
+			//objects with non trivial destructors get a dtor_node_t in front of them in the same block
+			//and are destroyed in reverse order of creation on ClearArena/FreeArena/Rewind/destruction.
+			//trivially destructible ones are plain allocations.
+			//lock is not held while the objects are constructed so constructors may allocate from the same arena
+			template<typename T, typename Lock, typename...Args>
+			[[nodiscard]]
+			T* New(Lock& lock, Args&&...args) {
+				T* mem = nullptr;
+				{
+					lock_guard_t<Lock> guard(lock);
+					mem = allocate_objects<T>(1);
+				}
+				T* obj = nullptr;
+				try {
+					obj = ::new(static_cast<void*>(mem)) T(std::forward<Args>(args)...);
+				}
+				catch (...) {
+					lock_guard_t<Lock> guard(lock);
+					deallocate_objects(mem, 1);
+					throw;
+				}
+				lock_guard_t<Lock> guard(lock);
+				register_destructor(obj, 1);
+				return obj;
+			}
+			template<typename T, typename Lock>
+			[[nodiscard]]
+			T* NewArray(Lock& lock, std::size_t num) {
+				T* mem = nullptr;
+				{
+					lock_guard_t<Lock> guard(lock);
+					mem = allocate_objects<T>(num);
+				}
+				std::size_t i = 0;
+				try {
+					for (; i < num; ++i) {
+						::new(static_cast<void*>(mem + i)) T();
+					}
+				}
+				catch (...) {
+					while (i-- > 0) {
+						mem[i].~T();
+					}
+					lock_guard_t<Lock> guard(lock);
+					deallocate_objects(mem, num);
+					throw;
+				}
+				T* arr = std::launder(mem);
+				lock_guard_t<Lock> guard(lock);
+				register_destructor(arr, num);
+				return arr;
+			}
+			//same ownership rules as ReleaseArena
+			[[nodiscard]]
+			MEGU_CONSTEXPR void* ReleaseRegionContaining(void const* mem)noexcept {
+				return regs_.release_region_containing(mem);
+			}
+
+			//the cursor bump is inlined into the caller and everything else stays out of line behind it,
+			//uncounted arenas never free single blocks so they skip the slab pools too
+			template<bool Counted>
+			[[nodiscard]]
+			MEGU_CONSTEXPR void* alloc_fast(std::size_t bytes, std::size_t align)noexcept {
+				if constexpr (Counted) {
+					if (pools_.enabled_) {
+						return sampled(alloc_nothrow(bytes, align), bytes);
+					}
+				}
+				if (void* mem = regs_.template bump_cursor<Counted>(bytes, align)) {
+					return sampled(mem, bytes);
+				}
+				return sampled(regs_.try_alloc(bytes, align, growth_), bytes);
+			}
+			constexpr void set_counted(bool counted)noexcept {
+				regs_.set_counted(counted);
+			}
+
+			[[nodiscard]]
+			MEGU_CONSTEXPR void* alloc_nothrow(std::size_t bytes, std::size_t align)noexcept {
+				if (pools_.enabled_ && slab_pools_t::pooled(bytes, align)) {
+					return pool_alloc(slab_pools_t::class_of(bytes));
+				}
+				return regs_.try_alloc(bytes, align, growth_);
+			}
+			[[nodiscard]]
+			MEGU_CONSTEXPR void* realloc_nothrow(void* mem, std::size_t olds, std::size_t news, std::size_t align)noexcept {
+				void* remem = nullptr;
+				if (pools_.enabled_ && mem != nullptr
+					&& (slab_pools_t::pooled(olds, align) || slab_pools_t::pooled(news, align))) {
+					remem = pool_realloc(mem, olds, news, align);
+				}
+				else {
+					remem = regs_.try_realloc(mem, olds, news, align, growth_);
+				}
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+				sampler_.on_realloc(mem, remem, news);
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+				return remem;
+			}
+			//without per block frees the old block stays where it is, the data always moves to a fresh one
+			[[nodiscard]]
+			MEGU_CONSTEXPR void* realloc_moved(void* mem, std::size_t olds, std::size_t news, std::size_t align)noexcept {
+				void* remem = nullptr;
+				if (news != 0) {
+					remem = regs_.template bump_cursor<false>(news, align);
+					if (remem == nullptr) {
+						remem = regs_.try_alloc(news, align, growth_);
+					}
+					if (remem != nullptr && mem != nullptr) {
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+						std::memcpy(remem, mem, std::min(olds, news));
+#else //MEGU_USE_CONSTEXPR_ALLOC
+						std::copy(static_cast<char const*>(mem), static_cast<char const*>(mem) + std::min(olds, news), static_cast<char*>(remem));
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+					}
+				}
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+				sampler_.on_realloc(mem, remem, news);
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+				return remem;
+			}
+
+			MEGU_CONSTEXPR void dealloc(void* mem, std::size_t bytes, std::size_t align)noexcept {
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+				sampler_.on_free(mem);
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+				if (pools_.enabled_ && mem != nullptr && slab_pools_t::pooled(bytes, align)) {
+					return pools_.push(slab_pools_t::class_of(bytes), mem);
+				}
+				return regs_.dealloc(mem, bytes, align);
+			}
+
+			[[nodiscard]]
+			MEGU_CONSTEXPR void* sampled(void* mem, std::size_t bytes)noexcept {
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+				sampler_.on_alloc(mem, bytes);
+#else //MEGU_USE_CONSTEXPR_ALLOC
+				(void)bytes;
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+				return mem;
+			}
+			MEGU_CONSTEXPR void forget_samples(std::size_t since)noexcept {
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+				sampler_.forget_since(since);
+#else //MEGU_USE_CONSTEXPR_ALLOC
+				(void)since;
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+			}
+
+		private:
+			[[nodiscard]]
+			void* pool_alloc(unsigned c)noexcept {
+				if (void* mem = pools_.pop(c)) {
+					return mem;
+				}
+				void* slab = regs_.try_alloc(slab_pools_t::slab_size, slab_pools_t::alignment, growth_);
+				if (slab == nullptr) {
+					return nullptr;
+				}
+				pools_.refill(c, slab);
+				return pools_.pop(c);
+			}
+
+			[[nodiscard]]
+			void* pool_realloc(void* mem, std::size_t olds, std::size_t news, std::size_t align)noexcept {
+				if (news == 0) {
+					dealloc(mem, olds, align);
+					return nullptr;
+				}
+				if (slab_pools_t::pooled(olds, align) && slab_pools_t::pooled(news, align)
+					&& slab_pools_t::class_of(olds) == slab_pools_t::class_of(news)) {
+					return mem;
+				}
+				void* remem = alloc_nothrow(news, align);
+				if (remem == nullptr) {
+					return nullptr;
+				}
+				std::memcpy(remem, mem, std::min(olds, news));
+				dealloc(mem, olds, align);
+				return remem;
+			}
+
+			template<typename T>
+			static constexpr std::size_t dtor_header_size()noexcept {
+				if constexpr (std::is_trivially_destructible_v<T>) {
+					return 0;
+				}
+				else {
+					return (sizeof(dtor_node_t) + alignof(T) - 1) / alignof(T) * alignof(T);
+				}
+			}
+			template<typename T>
+			static constexpr std::size_t objects_align()noexcept {
+				return dtor_header_size<T>() == 0 ? alignof(T) : std::max(alignof(T), alignof(dtor_node_t));
+			}
+
+			template<typename T>
+			[[nodiscard]]
+			T* allocate_objects(std::size_t num) {
+				if (num > (std::numeric_limits<std::size_t>::max() - dtor_header_size<T>()) / sizeof(T)) {
+					throw std::bad_array_new_length();
+				}
+				std::size_t const nbytes = dtor_header_size<T>() + num * sizeof(T);
+				char* block = static_cast<char*>(sampled(alloc_nothrow(nbytes, objects_align<T>()), nbytes));
+				if (block == nullptr) {
+					throw std::bad_alloc();
+				}
+				return reinterpret_cast<T*>(block + dtor_header_size<T>());
+			}
+			template<typename T>
+			void deallocate_objects(T* objs, std::size_t num)noexcept {
+				dealloc(reinterpret_cast<char*>(objs) - dtor_header_size<T>(),
+					dtor_header_size<T>() + num * sizeof(T), objects_align<T>());
+			}
+			template<typename T>
+			void register_destructor(T* objs, std::size_t num)noexcept {
+				if constexpr (!std::is_trivially_destructible_v<T>) {
+					static_assert(std::is_nothrow_destructible_v<T>, "Destructor should be noexcept");
+					void* at = reinterpret_cast<char*>(objs) - dtor_header_size<T>();
+					dtors_ = ::new(at) dtor_node_t{ [](void* data, std::size_t count)noexcept {
+						T* arr = static_cast<T*>(data);
+						while (count-- > 0) {
+							arr[count].~T();
+						}
+					}, objs, num, dtors_ };
+				}
+			}
+
+			MEGU_CONSTEXPR void run_destructors_until(dtor_node_t* stop)noexcept {
+				while (dtors_ != stop && dtors_ != nullptr) {
+					dtor_node_t* n = dtors_;
+					dtors_ = n->next_;
+					n->dtor_(n->objs_, n->count_);
+				}
+			}
+
+			struct region_list_t {
+				constexpr region_list_t(region_list_t const&) = delete;
+				constexpr region_list_t(region_list_t&&) = delete;
+				constexpr region_list_t& operator=(region_list_t const&) = delete;
+				constexpr region_list_t& operator=(region_list_t&&) = delete;
+
+				struct region_node_t : public detail::region_t {
+					using detail::region_t::region_t;
+					constexpr region_node_t(region_node_t const&) = delete;
+					constexpr region_node_t(region_node_t&&) = delete;
+					constexpr region_node_t& operator=(region_node_t const&) = delete;
+					constexpr region_node_t& operator=(region_node_t&&) = delete;
+
+					region_node_t* next_{ nullptr };
+					region_node_t* prev_{ nullptr };
+					region_list_t const* list_{ nullptr };//owner check for page map lookups
+
+					//free space index links, a region sits in bin floor(log2(capacity - size)), or on the empty list
+					region_node_t* bin_next_{ nullptr };
+					region_node_t* bin_prev_{ nullptr };
+					unsigned char bin_{ unbinned };
+
+					std::size_t seq_{ 0 };//creation order, the list is kept sorted on it newest first
+				};
+
+				static constexpr unsigned char unbinned = 0xFF;
+				static constexpr unsigned char empty_bin = 0xFE;
+				static constexpr unsigned char large_bin = 0xFD;//blocks with a mapping of their own, on the large list
+				static constexpr std::size_t large_auto_min = (1 << 17);//where malloc starts mapping blocks of their own
+				static constexpr unsigned nbins = 64;
+
+				constexpr region_list_t()
+					:size_(0), head_(nullptr), cursor_(nullptr), bins_{}, bin_mask_(0),
+					last_cap_(0), sys_allocs_(0), sys_frees_(0), pages_(HugePages_t::NONE), cache_(nullptr),
+					next_seq_(0), floor_{ nullptr, 0, 0, false }, empty_(nullptr),
+					large_(nullptr), nlarge_(0), large_threshold_(0), small_max_(std::numeric_limits<std::size_t>::max()), counted_(true),
+					bumped_(0), cursor_base_(0), padding_(0), slow_hits_(0), capacity_(0), peak_capacity_(0), peak_regions_(0) {}
+
+				~region_list_t() {
+					free_all();
+				}
+
+				MEGU_CONSTEXPR void dealloc(void const* mem, std::size_t nbytes, std::size_t align)noexcept {
+					cursor_sync_t sync(*this);
+					auto* node = node_containing(mem);
+					if (!node) {
+						return;
+					}
+					if (node->bin_ == large_bin) {
+						return free_large(node);
+					}
+					return free_reservation_in_region(node, mem, nbytes, align);
+				}
+
+				//bumps the cursor region, falls back to the free space index and only then to a new region,
+				//which gets headroom bytes of room on top of the growth policy's capacity
+				//the cursor branch of try_alloc alone, null sends the caller down try_alloc
+				template<bool Counted>
+				[[nodiscard]]
+				MEGU_CONSTEXPR void* bump_cursor(std::size_t nbytes, std::size_t align)noexcept {
+					region_node_t* r = cursor_;
+					if (r == nullptr || nbytes > small_max_) {
+						return nullptr;
+					}
+					std::size_t const aligned = static_cast<std::size_t>(alignment_offset(align, r->begin()));
+					std::size_t const space = free_space(r);
+					if (aligned > space || nbytes > space - aligned) {
+						return nullptr;
+					}
+					void* mem = r->begin() + aligned;
+					r->size() += nbytes + aligned;
+					if constexpr (Counted) {
+						r->nallocations()++;
+					}
+					if (aligned != 0) {//the bytes themselves are picked up from the cursor's size by cursor_sync_t
+						padding_ += aligned;
+					}
+					return mem;
+				}
+
+				[[nodiscard]]
+				MEGU_CONSTEXPR void* try_alloc(std::size_t nbytes, std::size_t align,
+					GrowthPolicy const& growth, std::size_t headroom = 0)noexcept {
+					cursor_sync_t sync(*this);
+					if (large_threshold_ != 0 && nbytes >= large_threshold_) {
+						return alloc_large(nbytes, align, headroom);
+					}
+					if (cursor_ != nullptr && fits_in_region(cursor_, nbytes, align)) {
+						return reserve_region(cursor_, nbytes, align);
+					}
+					slow_hits_++;
+					//under a mark new blocks must stay above it, so only the cursor and empty or fresh regions are used
+					region_node_t* r = find_fit(nbytes, align, floor_.active_);
+					if (r != nullptr && floor_.active_) {
+						move_to_front(r);
+					}
+					if (r == nullptr) {
+						//by default a block bigger than any region the policy would make gets a mapping of its own,
+						//small ones still go to regions so churning them does not turn into a system call each
+						if (large_threshold_ == 0 && nbytes >= large_auto_min && nbytes > growth.next_capacity(0, last_cap_, size_)) {
+							return alloc_large(nbytes, align, headroom);
+						}
+						std::size_t const want = nbytes + std::min(headroom, std::numeric_limits<std::size_t>::max() - nbytes);
+						r = push_front(growth.next_capacity(want, last_cap_, size_), align);
+						if (r == nullptr) {
+							return nullptr;
+						}
+					}
+					set_cursor(r);
+					return reserve_region(r, nbytes, align);
+				}
+
+				//adds an empty region when the empty ones hold less than nbytes in total
+				MEGU_CONSTEXPR bool reserve(std::size_t nbytes, GrowthPolicy const& growth, Prefault_t prefault)noexcept {
+					cursor_sync_t sync(*this);
+					std::size_t avail = 0;
+					for (region_node_t* e = empty_; e != nullptr && avail < nbytes; e = e->bin_next_) {
+						avail += e->capacity();
+					}
+					if (avail >= nbytes) {
+						return true;
+					}
+					std::size_t const need = nbytes - avail;
+					region_node_t* r = push_front(growth.next_capacity(need, last_cap_, size_), __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+					if (r == nullptr) {
+						return false;
+					}
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+					prefault_region(r->data(), r->capacity(), prefault);
+#else //MEGU_USE_CONSTEXPR_ALLOC
+					(void)prefault;
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+					rebin(r);
+					return true;
+				}
+
+				MEGU_CONSTEXPR void* try_realloc(void* mem, std::size_t olds, std::size_t news, std::size_t align,
+					GrowthPolicy const& growth)noexcept {
+					cursor_sync_t sync(*this);
+					if (mem == nullptr) {//if realloc was called in place of alloc
+						return try_alloc(news, align, growth);
+					}
+					if (news == olds) {//weird case but whatever
+						return mem;
+					}
+					//find the region
+					auto* region = node_containing(mem);
+					if (region == nullptr) {//if memory is not part of this arena return null
+						return nullptr;
+					}
+					if (0 == news) {//if realloc to 0 free
+						if (region->bin_ == large_bin) {
+							free_large(region);
+						}
+						else {
+							free_reservation_in_region(region, mem, olds, align);
+						}
+						return nullptr;
+					}
+					if (region->bin_ == large_bin) {
+						return realloc_large(region, mem, olds, news, align, growth);
+					}
+					std::ptrdiff_t const d = news - olds;
+					// if shrinking or growing and is .back() resize and return
+					if (region->begin() - olds == mem && region->begin() + d <= region->end()
+						&& (d < 0 || above_floor(region, mem))) {
+						region->size() += d;
+						if (d > 0) {
+							bumped_ += static_cast<std::size_t>(d);
+						}
+						rebin(region);
+						return mem;
+					}
+					if (d < 0) {//if its shrinking and not .back() return as is
+						return mem;
+					}
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+					//a large block alone in its own mapping is resized by the kernel instead of copied
+					if (olds >= remap_threshold && mem == region->data() && region->size() == olds
+						&& region->nallocations() == 1 && region->remappable() && above_floor(region, mem)) {
+						if (void* moved = remap_node(region, news)) {
+							return moved;
+						}
+					}
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+
+					//allocate a new region if it doesnt fit, a block that had to move gets as much room again
+					//behind it so it can keep growing in place
+					auto* newreg = try_alloc(news, align, growth, news);
+					if (!newreg) {
+						return nullptr;
+					}
+					// if we are not using constexpr do a memcpy
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+					std::memcpy(newreg, mem, olds);
+#else //MEGU_USE_CONSTEXPR_ALLOC
+				//otherwise do a normal copy
+					char* newreg_ = reinterpret_cast<char*>(newreg);
+					char const* oldreg_ = reinterpret_cast<char const*>(mem);
+					std::copy(oldreg_, oldreg_ + olds, newreg_);
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+					free_reservation_in_region(region, mem, olds, align);
+					return newreg;
+				}
+
+				MEGU_CONSTEXPR void* release_region_containing(void const* mem)noexcept {
+					cursor_sync_t sync(*this);
+					auto* node = node_containing(mem);
+					if (node == nullptr) {
+						return nullptr;
+					}
+					unmap_node(node);
+					capacity_ -= node->capacity();
+					if (node->bin_ == large_bin) {
+						unlink_large(node);
+					}
+					else {
+						unlink(node);
+					}
+					return region_factory_t::release(node);
+				}
+
+				MEGU_CONSTEXPR std::vector<void*> release_all() {
+					cursor_sync_t sync(*this);
+					std::vector<void*> vec;
+					vec.reserve(size_ + nlarge_);
+					for (region_node_t* h = head_; h != nullptr; h = h->next_) {
+						unmap_node(h);
+						vec.push_back(h->release());
+					}
+					for (region_node_t* h = large_; h != nullptr; h = h->next_) {
+						unmap_node(h);
+						vec.push_back(h->release());
+					}
+					free_nodes();//free_all would fold the released cursor's size
+					return vec;
+				}
+
+				MEGU_CONSTEXPR void clear_all()noexcept {
+					cursor_sync_t sync(*this);
+					free_large_until(0);
+					for (region_node_t* h = head_; h != nullptr; h = h->next_) {
+						h->clear();
+						rebin(h);
+					}
+					floor_ = arena_position_t{ nullptr, 0, 0, false };
+				}
+
+				//makes the current position the floor and returns the previous one
+				MEGU_CONSTEXPR arena_position_t mark(arena_position_t& at, uint32_t& allocs)noexcept {
+					at = arena_position_t{ cursor_, cursor_ ? cursor_->size() : 0, next_seq_, true };
+					allocs = cursor_ ? cursor_->nallocations() : 0;
+					arena_position_t const prev = floor_;
+					floor_ = at;
+					return prev;
+				}
+
+				//regions created after the mark sit in front of the list and are emptied, the mark's region is cut back.
+				//blocks from before the mark that were freed while it was active are only reclaimed by clear_all
+				MEGU_CONSTEXPR void rewind(arena_position_t const& at, uint32_t allocs, arena_position_t const& prev)noexcept {
+					cursor_sync_t sync(*this);
+					if (!at.active_) {
+						return;
+					}
+					free_large_until(at.seq_);
+					for (region_node_t* h = head_; h != nullptr && h->seq_ >= at.seq_; h = h->next_) {
+						h->clear();
+						rebin(h);
+					}
+					if (auto* r = static_cast<region_node_t*>(at.region_)) {
+						r->size() = std::min(r->size(), at.offset_);
+						r->nallocations() = std::min(r->nallocations(), allocs);
+						if (unused(r)) {
+							r->clear();
+						}
+						rebin(r);
+						set_cursor(r);
+					}
+					floor_ = prev;
+				}
+				MEGU_CONSTEXPR void free_all()noexcept {
+					cursor_sync_t sync(*this);
+					free_nodes();
 				}
 
 				[[nodiscard]]
@@ -369,130 +1389,520 @@ namespace megu {
 					return head_ == nullptr;
 				}
 
-				[[nodiscard]]
-				MEGU_CONSTEXPR region_node_t* push_front(std::size_t bytes,
-					std::size_t align)noexcept
-				{
-					region_node_t* new_node = new(std::nothrow) region_node_t(bytes, align);
-					if (!new_node || !new_node->is_valid()) {
-						return nullptr;
+				[[nodiscard]]
+				MEGU_CONSTEXPR region_node_t* push_front(std::size_t bytes,
+					std::size_t align)noexcept
+				{
+					region_node_t* new_node = make_node(bytes, align);
+					if (!new_node) {
+						return nullptr;
+					}
+					last_cap_ = new_node->capacity();
+					if (!is_empty()) {
+						new_node->next_ = head_;
+						head_->prev_ = new_node;
+					}
+					new_node->seq_ = next_seq_++;
+					head_ = new_node;
+					size_++;
+					return new_node;
+				}
+
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+				static constexpr std::size_t remap_threshold = (1 << 20);
+
+				//grows the region under its only block to news with as much room again behind it, null if the system
+				//or the page map could not and the caller has to copy. the page map nodes for wherever the chunk ends up
+				//are made before it is moved, so once it is the new range is registered without failing
+				[[nodiscard]]
+				void* remap_node(region_node_t* r, std::size_t news)noexcept {
+					std::size_t const pg = static_cast<std::size_t>(GetPageSize());
+					std::size_t want = news <= std::numeric_limits<std::size_t>::max() / 2 ? news * 2 : news;
+					want = (want + pg - 1) & ~(pg - 1);
+					if (want < news) {
+						return nullptr;
+					}
+					page_map_t& map = global_page_map();
+					char* const old_data = static_cast<char*>(r->data());
+					std::size_t const old_cap = r->capacity();
+					if (map.reserve(old_data + old_cap, want - old_cap) && r->remap(want)) {
+						map.assign(old_data + old_cap, want - old_cap, r);
+					}
+					else {//no room behind it, move it onto a reservation whose pages the map is ready for
+						void* target = SysReserve(want, std::nothrow);
+						if (target == nullptr) {
+							return nullptr;
+						}
+						if (!map.reserve(target, want) || !r->remap(want, target)) {
+							SysFree(target, want);
+							return nullptr;
+						}
+						map.clear(old_data, old_cap);
+						map.assign(target, want, r);
+					}
+					capacity_ += r->capacity() - old_cap;
+					peak_capacity_ = std::max(peak_capacity_, capacity_);
+					bumped_ += news - r->size();
+					r->size() = news;
+					if (r->bin_ != large_bin) {
+						rebin(r);
+					}
+					return r->data();
+				}
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+
+				//O(1) through the page map, only regions made during constant evaluation are not in it and get scanned
+				[[nodiscard]]
+				MEGU_CONSTEXPR region_node_t* node_containing(void const* mem) const noexcept {
+					if (constant_evaluated()) {
+						for (region_node_t* list : { head_, large_ }) {
+							for (auto* n = list; n != nullptr; n = n->next_) {
+								if (n->in_region(mem)) {
+									return n;
+								}
+							}
+						}
+						return nullptr;
+					}
+					auto* node = static_cast<region_node_t*>(global_page_map().get(mem));
+					if (node == nullptr || node->list_ != this || !node->in_region(mem)) {
+						return nullptr;
+					}
+					return node;
+				}
+
+				MEGU_CONSTEXPR void unlink(region_node_t* node)noexcept {
+					if (node == cursor_) {
+						cursor_ = nullptr;
+					}
+					else {
+						bin_remove(node);
+					}
+					if (node->prev_) {
+						node->prev_->next_ = node->next_;
+					}
+					else {
+						head_ = node->next_;
+					}
+					if (node->next_) {
+						node->next_->prev_ = node->prev_;
+					}
+					node->next_ = nullptr;
+					node->prev_ = nullptr;
+					size_--;
+				}
+
+				[[nodiscard]]
+				constexpr region_node_t* head()noexcept {
+					return head_;
+				}
+
+				MEGU_CONSTEXPR void remove_unused()noexcept {
+					cursor_sync_t sync(*this);
+					for (auto* n = head_; n != nullptr;) {
+						auto* nxt = n->next_;
+						if (unused(n)) {
+							unlink(n);
+							destroy_node(n);
+						}
+						n = nxt;
+					}
+				}
+
+				constexpr std::size_t size()const noexcept {
+					return size_;
+				}
+				constexpr std::size_t nlarge()const noexcept {
+					return nlarge_;
+				}
+				constexpr std::size_t large_threshold()const noexcept {
+					return large_threshold_;
+				}
+				constexpr void set_large_threshold(std::size_t threshold)noexcept {
+					large_threshold_ = threshold;
+					small_max_ = threshold == 0 ? std::numeric_limits<std::size_t>::max() : threshold - 1;
+				}
+				constexpr void set_counted(bool counted)noexcept {
+					counted_ = counted;
+				}
+				constexpr std::size_t sys_allocs()const noexcept {
+					return sys_allocs_;
+				}
+				constexpr std::size_t sys_frees()const noexcept {
+					return sys_frees_;
+				}
+				constexpr HugePages_t pages()const noexcept {
+					return pages_;
+				}
+				constexpr void set_pages(HugePages_t pages)noexcept {
+					pages_ = pages;
+				}
+				constexpr RegionCache* cache()const noexcept {
+					return cache_;
+				}
+				constexpr void set_cache(RegionCache* cache)noexcept {
+					cache_ = cache;
+				}
+
+				std::string dump_usage()const { 
+					std::ostringstream ss;
+					ss << "Dumping usage for arena region-list : " << this << " {\n"; 
+					for (auto* h = head_; h != nullptr; h = h->next_) { 
+						ss << "  ";
+						dump_usage_node(ss, h);
+						ss << "\n";
+					}
+					for (auto* h = large_; h != nullptr; h = h->next_) {
+						ss << "  large ";
+						dump_usage_node(ss, h);
+						ss << "\n";
+					}
+					ss << "}\n";
+					return ss.str();
+				}
+
+				[[nodiscard]]
+				MEGU_CONSTEXPR ArenaStats stats()const noexcept {
+					ArenaStats st{};
+					std::size_t const pending = cursor_ != nullptr ? cursor_->size() - cursor_base_ : 0;
+					st.bytes_requested = bumped_ + pending - padding_;
+					st.bytes_padding = padding_;
+					st.slow_path_hits = slow_hits_;
+					st.system_allocations = sys_allocs_;
+					st.system_frees = sys_frees_;
+					st.num_regions = size_;
+					st.num_large = nlarge_;
+					st.peak_regions = peak_regions_;
+					st.bytes_capacity = capacity_;
+					st.peak_bytes_capacity = peak_capacity_;
+					for (auto* h = head_; h != nullptr; h = h->next_) {
+						st.bytes_reserved += h->size();
+					}
+					for (auto* h = large_; h != nullptr; h = h->next_) {
+						st.bytes_reserved += h->size();
+					}
+					st.fragmentation = capacity_ == 0 ? 0.0 : 1.0 - static_cast<double>(st.bytes_reserved) / static_cast<double>(capacity_);
+					return st;
+				}
+
+			private:
+				static constexpr std::size_t free_space(region_node_t const* r)noexcept {
+					return r->capacity() - r->size();
+				}
+
+				constexpr void count_request(std::size_t nbytes, std::size_t padding)noexcept {
+					bumped_ += nbytes + padding;
+					padding_ += padding;
+				}
+
+				//bump_cursor leaves the cursor's bytes uncounted, every other operation on the list folds them into
+				//bumped_ on entry and takes the cursor's size as the new base on exit, so its own changes are not mistaken
+				//for bumps. nested operations see nothing to fold since the outer one has not touched a size yet
+				struct cursor_sync_t {
+					MEGU_CONSTEXPR explicit cursor_sync_t(region_list_t& list)noexcept
+						:list_(list) {
+						if (list_.cursor_ != nullptr) {
+							list_.bumped_ += list_.cursor_->size() - list_.cursor_base_;
+						}
+					}
+					MEGU_CONSTEXPR ~cursor_sync_t() {
+						list_.cursor_base_ = list_.cursor_ != nullptr ? list_.cursor_->size() : 0;
+					}
+					cursor_sync_t(cursor_sync_t const&) = delete;
+					cursor_sync_t& operator=(cursor_sync_t const&) = delete;
+
+					region_list_t& list_;
+				};
+
+				//without counts only an untouched region is known to be free
+				constexpr bool unused(region_node_t const* r)const noexcept {
+					return r->size() == 0 || (counted_ && r->nallocations() == 0);
+				}
+
+				static constexpr unsigned char bin_of(region_node_t const* r)noexcept {
+					if (r->size() == 0 && r->nallocations() == 0) {
+						return empty_bin;
+					}
+					std::size_t const space = free_space(r);
+					if (space == 0) {//full regions are not worth indexing
+						return unbinned;
+					}
+					return static_cast<unsigned char>(floor_log2(space));
+				}
+
+				constexpr region_node_t*& bin_head(unsigned char b)noexcept {
+					return b == empty_bin ? empty_ : bins_[b];
+				}
+
+				MEGU_CONSTEXPR void bin_insert(region_node_t* r)noexcept {
+					unsigned char const b = bin_of(r);
+					r->bin_ = b;
+					if (b == unbinned) {
+						return;
+					}
+					region_node_t*& head = bin_head(b);
+					r->bin_prev_ = nullptr;
+					r->bin_next_ = head;
+					if (head) {
+						head->bin_prev_ = r;
+					}
+					head = r;
+					if (b != empty_bin) {
+						bin_mask_ |= uint64_t(1) << b;
+					}
+				}
+
+				MEGU_CONSTEXPR void bin_remove(region_node_t* r)noexcept {
+					if (r->bin_ == unbinned) {
+						return;
+					}
+					unsigned char const b = r->bin_;
+					if (r->bin_prev_) {
+						r->bin_prev_->bin_next_ = r->bin_next_;
+					}
+					else {
+						bin_head(b) = r->bin_next_;
+					}
+					if (r->bin_next_) {
+						r->bin_next_->bin_prev_ = r->bin_prev_;
+					}
+					if (b != empty_bin && bins_[b] == nullptr) {
+						bin_mask_ &= ~(uint64_t(1) << b);
+					}
+					r->bin_next_ = nullptr;
+					r->bin_prev_ = nullptr;
+					r->bin_ = unbinned;
+				}
+
+				//the cursor is kept out of the index since it changes on every allocation
+				MEGU_CONSTEXPR void rebin(region_node_t* r)noexcept {
+					if (r == cursor_) {
+						return;
 					}
-					if (!is_empty()) {
-						new_node->next_ = head_;
+					if (r->bin_ != unbinned && bin_of(r) == r->bin_) {
+						return;
 					}
-					head_ = new_node;
-					size_++;
-					return new_node;
+					bin_remove(r);
+					bin_insert(r);
 				}
 
-				[[nodiscard]]
-				MEGU_CONSTEXPR region_node_t* push_next(region_node_t* node,
-					std::size_t bytes,
-					std::size_t align)noexcept
-				{
-					if (node->next_) {
-						return node->next_;
+				MEGU_CONSTEXPR void set_cursor(region_node_t* r)noexcept {
+					if (r == cursor_) {
+						return;
 					}
-					node->next_ = new(std::nothrow) region_node_t(bytes, align);
-					if (!node->next_ || !node->next_->is_valid()) {
-						return nullptr;
+					bin_remove(r);
+					region_node_t* old = cursor_;
+					cursor_ = r;
+					if (old != nullptr) {
+						bin_insert(old);
 					}
-					size_++;
-					return node->next_;
 				}
 
+				//smallest populated size class that can hold the request, only the head of the class
+				//the request itself falls into needs checking, every class above it is guaranteed to fit.
+				//partially used regions are preferred, empty ones are only taken when none of them fits
 				[[nodiscard]]
-				constexpr region_node_t* prev_node_containing(void const* mem) const noexcept {//never call this for head 
-					for (auto* n = head_; n->next_ != nullptr; n = n->next_) {
-						if (n->next_->in_region(mem)) {
-							return n;
+				MEGU_CONSTEXPR region_node_t* find_fit(std::size_t nbytes, std::size_t align, bool empty_only)const noexcept {
+					unsigned const lo = nbytes == 0 ? 0 : floor_log2(nbytes);
+					if (lo >= nbins) {
+						return nullptr;
+					}
+					uint64_t mask = empty_only ? 0 : bin_mask_ & (~uint64_t(0) << lo);
+					while (mask != 0) {
+						unsigned const b = lowest_set_bit(mask);
+						if (fits_in_region(bins_[b], nbytes, align)) {
+							return bins_[b];
+						}
+						mask &= mask - 1;
+					}
+					for (region_node_t* e = empty_; e != nullptr; e = e->bin_next_) {
+						if (fits_in_region(e, nbytes, align)) {
+							return e;
 						}
 					}
 					return nullptr;
 				}
 
-				MEGU_CONSTEXPR void remove_head()noexcept {
-					if (!head_) {
+				//renumbers an empty region as the newest one so rewinding a mark finds it again
+				MEGU_CONSTEXPR void move_to_front(region_node_t* r)noexcept {
+					r->seq_ = next_seq_++;
+					if (r == head_) {
 						return;
 					}
-					region_node_t* new_head = head_->next_;
-					head_->next_ = nullptr;
-					delete head_;
-					size_--;
-					head_ = new_head;
-				}
-
-				MEGU_CONSTEXPR void remove_next(region_node_t* node)noexcept {
-					if (node->next_ == nullptr) {
-						return;
+					r->prev_->next_ = r->next_;
+					if (r->next_) {
+						r->next_->prev_ = r->prev_;
 					}
-					region_node_t* isolated = node->next_;//grab next node to delete
-					node->next_ = node->next_->next_;//skip the next node
-					isolated->next_ = nullptr;//remove detachment of the deleted node for proper destruction
-					size_--;//dec size
-					delete isolated;
+					r->prev_ = nullptr;
+					r->next_ = head_;
+					head_->prev_ = r;
+					head_ = r;
 				}
 
 				[[nodiscard]]
-				constexpr region_node_t* head()noexcept {
-					return head_;
-				}
-
-				constexpr void remove_unused()noexcept {
-					while (head_ && (0 == head_->size() || 0 == head_->nallocations())) {
-						remove_head();
+				MEGU_CONSTEXPR region_node_t* make_node(std::size_t bytes, std::size_t align)noexcept {
+					bool from_system = true;
+					region_node_t* node = region_factory_t::create<region_node_t>(bytes, align, pages_, cache_, from_system);
+					if (!node) {
+						return nullptr;
 					}
-					if (!head_) {
-						return;
+					if (!node->is_valid()) {
+						region_factory_t::destroy(node, nullptr);
+						return nullptr;
 					}
-					for (auto* n = head_; n->next_ != nullptr; n = n->next_) {
-						if (0 == n->next_->size() || 0 == n->next_->nallocations()) {
-							remove_next(n);
-						}
+					node->list_ = this;
+					if (!constant_evaluated() && !global_page_map().set(node->data(), node->capacity(), node)) {
+						region_factory_t::destroy(node, cache_);
+						return nullptr;
 					}
+					if (from_system) {
+						sys_allocs_++;
+					}
+					capacity_ += node->capacity();
+					peak_capacity_ = std::max(peak_capacity_, capacity_);
+					peak_regions_ = std::max(peak_regions_, size_ + nlarge_ + 1);//linked by the caller right after
+					return node;
 				}
 
-				constexpr std::size_t size()const noexcept {
-					return size_;
+				static MEGU_CONSTEXPR void unmap_node(region_node_t* node)noexcept {
+					if (!constant_evaluated() && node->is_valid()) {
+						global_page_map().clear(node->data(), node->capacity());
+					}
 				}
 
-				std::string dump_usage()const { 
-					std::ostringstream ss;
-					ss << "Dumping usage for arena region-list : " << this << " {\n"; 
-					for (auto* h = head_; h != nullptr; h = h->next_) { 
-						ss << "  ";
-						dump_usage_node(ss, h);
-						ss << "\n";
+				MEGU_CONSTEXPR void destroy_node(region_node_t* node)noexcept {
+					capacity_ -= node->capacity();
+					unmap_node(node);
+					if (region_factory_t::destroy(node, cache_)) {
+						sys_frees_++;
 					}
-					ss << "}\n";
-					return ss.str();
 				}
 
-			private:
 				MEGU_CONSTEXPR void free_nodes()noexcept {
+					free_large_until(0);
 					region_node_t* h = head_;
 					while (h = free_node(h));
 					head_ = nullptr;
 					size_ = 0;
+					last_cap_ = 0;
+					capacity_ = 0;//chunks handed out by release_all reach destroy_node with no capacity left
+					cursor_ = nullptr;
+					floor_ = arena_position_t{ nullptr, 0, 0, false };
+					for (auto& b : bins_) {
+						b = nullptr;
+					}
+					bin_mask_ = 0;
+					empty_ = nullptr;
 				}
 
-				static MEGU_CONSTEXPR region_node_t* free_node(region_node_t* node)noexcept {
+				MEGU_CONSTEXPR region_node_t* free_node(region_node_t* node)noexcept {
 					if (node == nullptr) {
 						return nullptr;
 					}
 					auto* nxt = node->next_;
 					node->next_ = nullptr;
-					delete node;
+					node->prev_ = nullptr;
+					destroy_node(node);
 					return nxt;
 				}
 
+				//whether mem was handed out after the youngest mark, only those blocks may grow in place
+				[[nodiscard]]
+				constexpr bool above_floor(region_node_t const* r, void const* mem)const noexcept {
+					if (!floor_.active_ || r->seq_ >= floor_.seq_) {
+						return true;
+					}
+					return r == floor_.region_ && static_cast<char const*>(mem) >= static_cast<char const*>(r->data()) + floor_.offset_;
+				}
+
 				static constexpr bool fits_in_region(region_node_t const* r,
 					std::size_t nbytes, std::size_t align)noexcept {
 					nbytes += alignment_offset(align, r->begin());
-					return r->begin() + nbytes < r->end();
+					return r->begin() + nbytes <= r->end();
+				}
+
+				//headers stay out of the mapping so the block starts on a page and can be remapped
+				[[nodiscard]]
+				MEGU_CONSTEXPR void* alloc_large(std::size_t nbytes, std::size_t align, std::size_t headroom)noexcept {
+					std::size_t const want = nbytes + std::min(headroom, std::numeric_limits<std::size_t>::max() - nbytes);
+					region_node_t* r = make_node(want, align);
+					if (r == nullptr) {
+						return nullptr;
+					}
+					r->bin_ = large_bin;
+					r->seq_ = next_seq_++;
+					r->next_ = large_;
+					if (large_ != nullptr) {
+						large_->prev_ = r;
+					}
+					large_ = r;
+					nlarge_++;
+					return reserve_region(r, nbytes, align);
+				}
+
+				[[nodiscard]]
+				MEGU_CONSTEXPR void* realloc_large(region_node_t* r, void* mem, std::size_t olds, std::size_t news,
+					std::size_t align, GrowthPolicy const& growth)noexcept {
+					std::size_t const offset = static_cast<std::size_t>(static_cast<char*>(mem) - static_cast<char*>(r->data()));
+					//a block from before the youngest mark has to be there unchanged once the mark is rewound
+					bool const movable = above_floor(r, mem);
+					if (news <= olds || (movable && news <= r->capacity() - offset)) {//the block is alone in its mapping
+						if (movable) {
+							bumped_ += news > olds ? news - olds : 0;
+							r->size() = offset + news;
+						}
+						return mem;
+					}
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+					if (movable && offset == 0 && r->remappable()) {
+						if (void* moved = remap_node(r, news)) {
+							return moved;
+						}
+					}
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+					void* remem = try_alloc(news, align, growth, news);
+					if (remem == nullptr) {
+						return nullptr;
+					}
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+					std::memcpy(remem, mem, olds);
+#else //MEGU_USE_CONSTEXPR_ALLOC
+					std::copy(static_cast<char const*>(mem), static_cast<char const*>(mem) + olds, static_cast<char*>(remem));
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+					if (movable) {
+						free_large(r);
+					}
+					return remem;
+				}
+
+				MEGU_CONSTEXPR void unlink_large(region_node_t* r)noexcept {
+					if (r->prev_ != nullptr) {
+						r->prev_->next_ = r->next_;
+					}
+					else {
+						large_ = r->next_;
+					}
+					if (r->next_ != nullptr) {
+						r->next_->prev_ = r->prev_;
+					}
+					r->next_ = nullptr;
+					r->prev_ = nullptr;
+					nlarge_--;
 				}
 
-				static constexpr void free_reservation_in_region(region_node_t* r,
+				MEGU_CONSTEXPR void free_large(region_node_t* r)noexcept {
+					unlink_large(r);
+					destroy_node(r);
+				}
+
+				//large blocks are newest first, so those handed out since seq are a prefix
+				MEGU_CONSTEXPR void free_large_until(std::size_t seq)noexcept {
+					while (large_ != nullptr && large_->seq_ >= seq) {
+						free_large(large_);
+					}
+				}
+
+				MEGU_CONSTEXPR void free_reservation_in_region(region_node_t* r,
 					void const* block_to_dealloc,
 					std::size_t nbytes,
 					std::size_t align)noexcept {
@@ -505,6 +1915,7 @@ namespace megu {
 						r->size() -= nbytes;
 					}
 					/*r->size() -= alignment_offset(align, r->begin());  */
+					rebin(r);
 				}
 
 				static void dump_usage_node(std::ostringstream& ss,region_node_t* n) {
@@ -514,41 +1925,132 @@ namespace megu {
 						<< ", data-address : " << n->data() << ">";
 				}
 
-				static constexpr void* reserve_region(region_node_t* r, std::size_t nbytes, std::size_t align)noexcept {
+				constexpr void* reserve_region(region_node_t* r, std::size_t nbytes, std::size_t align)noexcept {
 					assert(r->is_valid());
 					auto const aligned = alignment_offset(align, r->begin());
 					void* ret = r->begin() + aligned;
 					r->size() += nbytes + aligned;
 					r->nallocations()++;
+					count_request(nbytes, static_cast<std::size_t>(aligned));
 					assert(ret != nullptr);
 					return ret;
 				}
 
 				std::size_t size_;
 				region_node_t* head_;
+				region_node_t* cursor_;//region the fast path bumps, never indexed
+				region_node_t* bins_[nbins];
+				uint64_t bin_mask_;//bit b set when bins_[b] is not empty
+				std::size_t last_cap_;//capacity of the newest region, feeds the growth policy
+				std::size_t sys_allocs_;
+				std::size_t sys_frees_;
+				HugePages_t pages_;
+				RegionCache* cache_;//regions are recycled through it instead of going back to the system when set
+				std::size_t next_seq_;
+				arena_position_t floor_;//youngest live mark
+				region_node_t* empty_;//regions with nothing allocated in them
+				region_node_t* large_;//newest first, never scanned by allocations
+				std::size_t nlarge_;
+				std::size_t large_threshold_;//0 picks blocks no region of the growth policy would hold
+				std::size_t small_max_;//largest block bump_cursor may serve, below large_threshold_
+				bool counted_;//false when blocks are never freed one by one and nallocations() is not kept up
+				std::size_t bumped_;//the counters behind ArenaStats, requested bytes are bumped_ - padding_
+				std::size_t cursor_base_;//cursor's size when bumped_ was last brought up to date
+				std::size_t padding_;
+				std::size_t slow_hits_;
+				std::size_t capacity_;
+				std::size_t peak_capacity_;
+				std::size_t peak_regions_;
 			};
 
 			region_list_t regs_;
-			std::size_t min_cap_;
+			GrowthPolicy growth_;
+			dtor_node_t* dtors_;//newest first
+			slab_pools_t pools_;
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+			heap_sampler_t sampler_;
+#endif //MEGU_USE_CONSTEXPR_ALLOC
 		};
 
 	}//end detail
 
-	class Arena : public detail::ArenaBase { 
+	//arena whose features are picked at compile time so the unused ones cost nothing on the Allocate path.
+	//with NoLock, BulkFree and a constant alignment an allocation that fits the current region is a bounds check and a bump.
+	//the setters inherited from ArenaBase are not locked, configure the arena before sharing it
+	template<typename LockPolicy = NoLock, typename FreePolicy = IndividualFree, typename AlignPolicy = DynamicAlign>
+	class BasicArena : public detail::ArenaBase {
+		using guard_t = detail::lock_guard_t<LockPolicy>;
+		static constexpr bool counted = FreePolicy::counted;
 	public:
-		constexpr Arena(std::size_t cap = (1 << 12))noexcept
-			:ArenaBase(cap) {} 
+		static constexpr std::size_t default_alignment = AlignPolicy::default_alignment;
+
+		constexpr BasicArena(std::size_t cap = (1 << 12))noexcept
+			:ArenaBase(cap), lock_() {
+			set_counted(counted);
+		}
+		constexpr BasicArena(GrowthPolicy growth)noexcept
+			:ArenaBase(growth), lock_() {
+			set_counted(counted);
+		}
 
-		using ArenaBase::FreeArena; 
-		using ArenaBase::FreeUnusedRegions; 
-		using ArenaBase::ClearArena;
-		using ArenaBase::ReleaseArena;
-		using ArenaBase::ReleaseRegionContaining;
+		MEGU_CONSTEXPR void FreeArena()noexcept {
+			guard_t guard(lock_);
+			ArenaBase::FreeArena();
+		}
+		MEGU_CONSTEXPR void FreeUnusedRegions()noexcept {
+			guard_t guard(lock_);
+			ArenaBase::FreeUnusedRegions();
+		}
+		MEGU_CONSTEXPR bool Reserve(std::size_t nbytes, Prefault_t prefault = Prefault_t::NONE)noexcept {
+			guard_t guard(lock_);
+			return ArenaBase::Reserve(nbytes, prefault);
+		}
+		MEGU_CONSTEXPR void ClearArena()noexcept {
+			guard_t guard(lock_);
+			ArenaBase::ClearArena();
+		}
+		[[nodiscard]]
+		MEGU_CONSTEXPR std::vector<void*> ReleaseArena() {
+			guard_t guard(lock_);
+			return ArenaBase::ReleaseArena();
+		}
+		[[nodiscard]]
+		MEGU_CONSTEXPR void* ReleaseRegionContaining(void const* mem)noexcept {
+			guard_t guard(lock_);
+			return ArenaBase::ReleaseRegionContaining(mem);
+		}
+		//Rewind(Mark()) frees everything allocated in between in one step, marks nest like a stack.
+		//a mark is invalidated by ClearArena/FreeArena/FreeUnusedRegions and by rewinding to an older one
+		[[nodiscard]]
+		MEGU_CONSTEXPR ArenaMark Mark()noexcept {
+			guard_t guard(lock_);
+			return ArenaBase::Mark();
+		}
+		MEGU_CONSTEXPR void Rewind(ArenaMark const& m)noexcept {
+			guard_t guard(lock_);
+			ArenaBase::Rewind(m);
+		}
+		[[nodiscard]]
+		MEGU_CONSTEXPR ArenaStats GetStats()noexcept {
+			guard_t guard(lock_);
+			return ArenaBase::GetStats();
+		}
+		//objects must not be released with ReleaseRegionContaining while the arena still owns their destructors
+		template<typename T, typename...Args>
+		[[nodiscard]]
+		T* New(Args&&...args) {
+			return ArenaBase::New<T>(lock_, std::forward<Args>(args)...);
+		}
+		template<typename T>
+		[[nodiscard]]
+		T* NewArray(std::size_t num) {
+			return ArenaBase::NewArray<T>(lock_, num);
+		}
 
 		[[nodiscard]]
 		MEGU_CONSTEXPR
-		void* Allocate(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
-			void* mem = this->alloc_nothrow(nbytes, align);
+		void* Allocate(std::size_t nbytes, std::size_t align = default_alignment) {
+			void* mem = alloc_locked(nbytes, align);
 			if (mem == nullptr) {
 				throw std::bad_alloc();
 			}
@@ -556,17 +2058,16 @@ namespace megu {
 		}
 		[[nodiscard]]
 		MEGU_CONSTEXPR
-		void* AllocateNoThrow(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
-			void* mem = this->alloc_nothrow(nbytes, align);
-			return mem;
+		void* AllocateNoThrow(std::size_t nbytes, std::size_t align = default_alignment)noexcept {
+			return alloc_locked(nbytes, align);
 		}
 		[[nodiscard]]
 		MEGU_CONSTEXPR
 		void* Reallocate(void* mem,
 			std::size_t old_size,
 			std::size_t new_size,
-			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
-			void* remem = this->realloc_nothrow(mem, old_size, new_size, align);
+			std::size_t align = default_alignment) {
+			void* remem = realloc_locked(mem, old_size, new_size, align);
 			if (remem == nullptr) {
 				throw std::bad_alloc();
 			}
@@ -578,86 +2079,422 @@ namespace megu {
 		void* ReallocateNoThrow(void* mem,
 			std::size_t old_size,
 			std::size_t new_size,
-			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
-			return this->realloc_nothrow(mem, old_size, new_size, align);
+			std::size_t align = default_alignment)noexcept {
+			return realloc_locked(mem, old_size, new_size, align);
 		}
 
-		[[nodiscard]]
 		MEGU_CONSTEXPR
 		void Deallocate(void* mem,
 			std::size_t nbytes,
-			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
-			return this->dealloc(mem, nbytes, align);
+			std::size_t align = default_alignment)noexcept {
+			if constexpr (counted) {
+				guard_t guard(lock_);
+				this->dealloc(mem, nbytes, std::max(align, AlignPolicy::min_alignment));
+			}
+		}
+
+	private:
+		[[nodiscard]]
+		MEGU_CONSTEXPR void* alloc_locked(std::size_t nbytes, std::size_t align)noexcept {
+			guard_t guard(lock_);
+			return this->template alloc_fast<counted>(nbytes, std::max(align, AlignPolicy::min_alignment));
+		}
+
+		[[nodiscard]]
+		MEGU_CONSTEXPR void* realloc_locked(void* mem, std::size_t olds, std::size_t news, std::size_t align)noexcept {
+			align = std::max(align, AlignPolicy::min_alignment);
+			guard_t guard(lock_);
+			if constexpr (counted) {
+				return this->realloc_nothrow(mem, olds, news, align);
+			}
+			else {
+				return this->realloc_moved(mem, olds, news, align);
+			}
 		}
 
+		LockPolicy lock_;
 	};
 
-	//TODO remove ArenaBase and rewrite a thread safe arena using atomics 
-	class ThreadSafeArena : public detail::ArenaBase {
+	using Arena = BasicArena<>;
+
+	//lock-free arena, Allocate/Reallocate/Deallocate bump the current region with CAS
+	//and only fall to the slow path when it is exhausted, the slow path walks and grows the region list under a mutex.
+	//FreeUnusedRegions/FreeArena/ClearArena/ReleaseArena/ReleaseRegionContaining take the same mutex but need every
+	//other thread to be out of Allocate/Reallocate/Deallocate, the lock-free path may still hold a region they drop.
+	//debug builds assert it
+	class ThreadSafeArena {
 	public:
 		ThreadSafeArena(std::size_t min_cap = GetPageSize())
-			:ArenaBase(min_cap), mutex_() {}
+			:min_cap_(min_cap), head_(nullptr), current_(nullptr), nregions_(0), pages_(HugePages_t::NONE), cache_(nullptr), mutex_() {}
+
+		ThreadSafeArena(ThreadSafeArena const&) = delete;
+		ThreadSafeArena(ThreadSafeArena&&) = delete;
+		ThreadSafeArena& operator=(ThreadSafeArena const&) = delete;
+		ThreadSafeArena& operator=(ThreadSafeArena&&) = delete;
+
+		~ThreadSafeArena() {
+			free_nodes();
+		}
+
+		std::size_t NumRegions()const noexcept {
+			return nregions_.load(std::memory_order_relaxed);
+		}
+
+		//applies to regions created from now on, huge page regions are rounded up to GetHugePageSize()
+		void SetHugePages(HugePages_t pages)noexcept {
+			pages_.store(pages, std::memory_order_relaxed);
+		}
+		[[nodiscard]]
+		HugePages_t GetHugePages()const noexcept {
+			return pages_.load(std::memory_order_relaxed);
+		}
+
+		//regions freed from now on are handed to cache and new ones are taken from it first,
+		//null gives them straight back to the system
+		void SetRegionCache(RegionCache* cache)noexcept {
+			cache_.store(cache, std::memory_order_release);
+		}
+		[[nodiscard]]
+		RegionCache* GetRegionCache()const noexcept {
+			return cache_.load(std::memory_order_acquire);
+		}
+
+		std::string DumpUsage() {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			std::ostringstream ss;
+			ss << "Dumping usage for thread safe arena : " << this << " {\n";
+			for (auto* h = head_.load(std::memory_order_acquire); h != nullptr; h = h->next_) {
+				ss << "  <Region[" << h << "], total_allocs : "
+					<< h->nallocations() << ", reserved : "
+					<< h->size() << ", capacity : " << h->capacity()
+					<< ", data-address : " << h->data() << ">\n";
+			}
+			ss << "}\n";
+			return ss.str();
+		}
 
 		void FreeUnusedRegions() {
 			std::scoped_lock<std::mutex> lock(mutex_);
-			ArenaBase::FreeUnusedRegions();
+			assert_quiescent();
+			region_node_t* cur = current_.load(std::memory_order_relaxed);
+			for (region_node_t* n = head_.load(std::memory_order_relaxed); n != nullptr;) {
+				region_node_t* nxt = n->next_;
+				if (n != cur && n->is_empty()) {
+					unlink(n);
+					destroy_node(n);
+				}
+				n = nxt;
+			}
+		}
+		//makes sure at least nbytes sit in published regions nothing is allocated from, see Arena::Reserve.
+		//a new region is prefaulted before it is published, only ASYNC keeps working on it afterwards
+		bool Reserve(std::size_t nbytes, Prefault_t prefault = Prefault_t::NONE)noexcept {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			region_node_t* cur = current_.load(std::memory_order_acquire);
+			std::size_t avail = 0;
+			for (auto* n = head_.load(std::memory_order_acquire); n != nullptr && avail < nbytes; n = n->next_) {
+				if (n != cur && n->size() == 0) {
+					avail += n->capacity();
+				}
+			}
+			if (avail >= nbytes) {
+				return true;
+			}
+			auto* node = make_node(std::max(nbytes - avail, min_cap_), __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+			if (!node) {
+				return false;
+			}
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+			detail::prefault_region(node->data(), node->capacity(), prefault);
+#else //MEGU_USE_CONSTEXPR_ALLOC
+			(void)prefault;
+#endif //MEGU_USE_CONSTEXPR_ALLOC
+			publish(node);
+			return true;
 		}
 		void FreeArena() {
 			std::scoped_lock<std::mutex> lock(mutex_);
-			ArenaBase::FreeArena();
+			assert_quiescent();
+			free_nodes();
 		}
-		void ClearArena(){
+		void ClearArena() {
 			std::scoped_lock<std::mutex> lock(mutex_);
-			ArenaBase::ClearArena();
+			assert_quiescent();
+			for (auto* h = head_.load(std::memory_order_relaxed); h != nullptr; h = h->next_) {
+				h->clear();
+			}
 		}
 		[[nodiscard]]
 		std::vector<void*> ReleaseArena() {
 			std::scoped_lock<std::mutex> lock(mutex_);
-			return ArenaBase::ReleaseArena();
+			assert_quiescent();
+			std::vector<void*> vec;
+			vec.reserve(NumRegions());
+			for (auto* h = head_.load(std::memory_order_relaxed); h != nullptr; h = h->next_) {
+				unmap_node(h);
+				vec.push_back(h->release());
+			}
+			free_nodes();
+			return vec;
 		}
 		[[nodiscard]]
-		void* ReleaseRegionContaining(void const* mem){ 
+		void* ReleaseRegionContaining(void const* mem) {
 			std::scoped_lock<std::mutex> lock(mutex_);
-			return ArenaBase::ReleaseRegionContaining(mem);  
+			assert_quiescent();
+			region_node_t* n = region_containing(mem);
+			if (n == nullptr) {
+				return nullptr;
+			}
+			unmap_node(n);
+			unlink(n);
+			return detail::region_factory_t::release(n);
 		}
 		[[nodiscard]]
 		void* Allocate(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
-			void* mem = nullptr;
-			{
-			   std::scoped_lock<std::mutex> lock(mutex_);
-			   mem = this->alloc_nothrow(nbytes, align);
-			}
+			void* mem = alloc_nothrow(nbytes, align);
 			if (mem == nullptr) {
 				throw std::bad_alloc();
 			}
 			return mem;
 		}
 		[[nodiscard]]
+		void* AllocateNoThrow(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			return alloc_nothrow(nbytes, align);
+		}
+		[[nodiscard]]
 		void* Reallocate(void* mem,
 			std::size_t old_size,
 			std::size_t new_size, 
 			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
-			void* remem = nullptr;
-			{
-			    std::scoped_lock<std::mutex> lock(mutex_);
-			    remem = this->realloc_nothrow(mem,old_size,new_size, align);
-			}
+			void* remem = realloc_nothrow(mem, old_size, new_size, align);
 			if (remem == nullptr) {
 				throw std::bad_alloc();
 			}
 			return remem;
 		}
-
 		[[nodiscard]]
+		void* ReallocateNoThrow(void* mem,
+			std::size_t old_size,
+			std::size_t new_size,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			return realloc_nothrow(mem, old_size, new_size, align);
+		}
+
 		void Deallocate(void* mem,
 			std::size_t nbytes,
-			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
-			std::scoped_lock<std::mutex> lock(mutex_);
-			return this->dealloc(mem, nbytes, align);
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			(void)align;
+			call_guard_t guard(*this);
+			auto* region = region_containing(mem);
+			if (region == nullptr) {
+				return;
+			}
+			region->free_reservation(mem, nbytes);
 		}
 
 	private:
-		std::mutex mutex_{};
+		using region_node_t = detail::atomic_region_t;
+
+		//marks a stretch of the lock-free path, debug builds count them so maintenance calls can assert none is running.
+		//threads waiting on mutex_ in the slow path are not counted, they are serialized with maintenance anyway
+		struct call_guard_t {
+#ifndef NDEBUG
+			explicit call_guard_t(ThreadSafeArena& arena)noexcept
+				:arena_(arena) {
+				arena_.calls_.fetch_add(1, std::memory_order_acq_rel);
+			}
+			~call_guard_t() {
+				arena_.calls_.fetch_sub(1, std::memory_order_acq_rel);
+			}
+			call_guard_t(call_guard_t const&) = delete;
+			call_guard_t& operator=(call_guard_t const&) = delete;
+
+			ThreadSafeArena& arena_;
+#else //NDEBUG
+			explicit constexpr call_guard_t(ThreadSafeArena&)noexcept {}
+#endif //NDEBUG
+		};
+
+		void assert_quiescent()const noexcept {
+#ifndef NDEBUG
+			assert(calls_.load(std::memory_order_acquire) == 0
+				&& "ThreadSafeArena maintenance call raced with Allocate/Reallocate/Deallocate");
+#endif //NDEBUG
+		}
+
+		[[nodiscard]]
+		void* alloc_nothrow(std::size_t nbytes, std::size_t align)noexcept {
+			region_node_t* r = nullptr;
+			{
+				call_guard_t guard(*this);
+				r = current_.load(std::memory_order_acquire);
+				if (r != nullptr) {
+					if (void* mem = r->try_reserve(nbytes, align)) {
+						return mem;
+					}
+				}
+			}
+			return alloc_slow(r, nbytes, align);
+		}
+
+		//the list is only walked and grown under mutex_, so no maintenance call can drop a region under it
+		[[nodiscard]]
+		void* alloc_slow(region_node_t* seen, std::size_t nbytes, std::size_t align)noexcept {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			//someone else may have already swapped in a fresh region
+			region_node_t* cur = current_.load(std::memory_order_acquire);
+			if (cur != seen && cur != nullptr) {
+				if (void* mem = cur->try_reserve(nbytes, align)) {
+					return mem;
+				}
+			}
+			//reuse a region that has been rewound to empty before asking the system for more memory
+			for (auto* n = head_.load(std::memory_order_acquire); n != nullptr; n = n->next_) {
+				if (n == cur || n->size() != 0 || n->capacity() < nbytes) {
+					continue;
+				}
+				if (void* mem = n->try_reserve(nbytes, align)) {
+					current_.compare_exchange_strong(cur, n);
+					return mem;
+				}
+			}
+			auto* node = make_node(std::max(nbytes, min_cap_), align);
+			if (!node) {
+				return nullptr;
+			}
+			//the node is still private so the first reservation cannot fail
+			void* mem = node->try_reserve(nbytes, align);
+			publish(node);
+			//if we lose this race our region stays published and is picked up once it is reused
+			current_.compare_exchange_strong(cur, node, std::memory_order_release, std::memory_order_relaxed);
+			return mem;
+		}
+
+		[[nodiscard]]
+		void* realloc_nothrow(void* mem, std::size_t olds, std::size_t news, std::size_t align)noexcept {
+			if (mem == nullptr) {//if realloc was called in place of alloc
+				return alloc_nothrow(news, align);
+			}
+			if (news == olds) {
+				return mem;
+			}
+			region_node_t* region = nullptr;
+			{
+				call_guard_t guard(*this);
+				region = region_containing(mem);
+				if (region == nullptr) {//if memory is not part of this arena return null
+					return nullptr;
+				}
+				if (0 == news) {
+					region->free_reservation(mem, olds);
+					return nullptr;
+				}
+				// if shrinking or growing and is .back() resize and return
+				if (region->try_resize_back(mem, olds, news)) {
+					return mem;
+				}
+				if (news < olds) {//if its shrinking and not .back() return as is
+					return mem;
+				}
+			}
+			void* newreg = alloc_nothrow(news, align);
+			if (!newreg) {
+				return nullptr;
+			}
+			std::memcpy(newreg, mem, olds);
+			call_guard_t guard(*this);
+			region->free_reservation(mem, olds);
+			return newreg;
+		}
+
+		//O(1) through the page map
+		[[nodiscard]]
+		region_node_t* region_containing(void const* mem)const noexcept {
+			auto* n = static_cast<region_node_t*>(detail::global_page_map().get(mem));
+			return n != nullptr && n->owner_ == this ? n : nullptr;
+		}
+
+		[[nodiscard]]
+		region_node_t* make_node(std::size_t bytes, std::size_t align)noexcept {
+			RegionCache* cache = cache_.load(std::memory_order_acquire);
+			bool from_system = true;
+			auto* node = detail::region_factory_t::create<region_node_t>(bytes, align,
+				pages_.load(std::memory_order_relaxed), cache, from_system);
+			if (!node) {
+				return nullptr;
+			}
+			if (!node->is_valid()) {
+				detail::region_factory_t::destroy(node, nullptr);
+				return nullptr;
+			}
+			node->owner_ = this;
+			if (!detail::global_page_map().set(node->data(), node->capacity(), node)) {
+				detail::region_factory_t::destroy(node, cache);
+				return nullptr;
+			}
+			return node;
+		}
+
+		void publish(region_node_t* node)noexcept {//call with mutex_ held
+			region_node_t* h = head_.load(std::memory_order_relaxed);
+			node->next_ = h;
+			if (h != nullptr) {
+				h->prev_ = node;
+			}
+			head_.store(node, std::memory_order_release);
+			nregions_.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		static void unmap_node(region_node_t* node)noexcept {
+			if (node->is_valid()) {
+				detail::global_page_map().clear(node->data(), node->capacity());
+			}
+		}
+
+		void destroy_node(region_node_t* node)noexcept {
+			unmap_node(node);
+			detail::region_factory_t::destroy(node, cache_.load(std::memory_order_acquire));
+		}
+
+		void unlink(region_node_t* node)noexcept {//call with mutex_ held
+			if (node->prev_ == nullptr) {
+				head_.store(node->next_, std::memory_order_release);
+			}
+			else {
+				node->prev_->next_ = node->next_;
+			}
+			if (node->next_ != nullptr) {
+				node->next_->prev_ = node->prev_;
+			}
+			if (current_.load(std::memory_order_relaxed) == node) {
+				current_.store(nullptr, std::memory_order_release);
+			}
+			node->next_ = nullptr;
+			node->prev_ = nullptr;
+			nregions_.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		void free_nodes()noexcept {
+			region_node_t* h = head_.exchange(nullptr);
+			current_.store(nullptr);
+			while (h != nullptr) {
+				region_node_t* nxt = h->next_;
+				destroy_node(h);
+				h = nxt;
+			}
+			nregions_.store(0, std::memory_order_relaxed);
+		}
+
+		std::size_t min_cap_;
+		std::atomic<region_node_t*> head_;
+		std::atomic<region_node_t*> current_;
+		std::atomic<std::size_t> nregions_;
+		std::atomic<HugePages_t> pages_;
+		std::atomic<RegionCache*> cache_;
+		std::mutex mutex_;
+#ifndef NDEBUG
+		std::atomic<std::size_t> calls_{ 0 };//threads on the lock-free path, see call_guard_t
+#endif //NDEBUG
 	};
 
 }//end megu
\ No newline at end of file
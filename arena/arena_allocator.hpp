@@ -0,0 +1,95 @@
+#pragma once
+#include "arena.hpp"
+#include <limits>
+#include <new>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+
+namespace megu {
+	//typed allocator over any arena with Allocate(bytes, align)/Deallocate(mem, bytes, align),
+	//copies share the arena and compare equal when they point at the same one
+	template<typename T, typename ArenaT = Arena>
+	class ArenaAllocator {
+	public:
+		using value_type = T;
+		using size_type = std::size_t;
+		using difference_type = std::ptrdiff_t;
+		using propagate_on_container_copy_assignment = std::true_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+		using is_always_equal = std::false_type;
+
+		template<typename U>
+		struct rebind {
+			using other = ArenaAllocator<U, ArenaT>;
+		};
+
+		constexpr ArenaAllocator(ArenaT& arena)noexcept
+			:arena_(&arena) {}
+		template<typename U>
+		constexpr ArenaAllocator(ArenaAllocator<U, ArenaT> const& other)noexcept
+			:arena_(other.arena()) {}
+
+		[[nodiscard]]
+		MEGU_CONSTEXPR T* allocate(std::size_t n) {
+			if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+				throw std::bad_array_new_length();
+			}
+			return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+		}
+		MEGU_CONSTEXPR void deallocate(T* mem, std::size_t n)noexcept {
+			arena_->Deallocate(mem, n * sizeof(T), alignof(T));
+		}
+
+		[[nodiscard]]
+		constexpr ArenaT* arena()const noexcept {
+			return arena_;
+		}
+
+		template<typename U>
+		constexpr bool operator==(ArenaAllocator<U, ArenaT> const& other)const noexcept {
+			return arena_ == other.arena();
+		}
+		template<typename U>
+		constexpr bool operator!=(ArenaAllocator<U, ArenaT> const& other)const noexcept {
+			return arena_ != other.arena();
+		}
+
+	private:
+		ArenaT* arena_;
+	};
+
+#ifdef __cpp_lib_memory_resource
+	//std::pmr::memory_resource over an arena that outlives it, allocation failures throw std::bad_alloc
+	template<typename ArenaT>
+	class BasicArenaResource final : public std::pmr::memory_resource {
+	public:
+		BasicArenaResource(ArenaT& arena)noexcept
+			:arena_(&arena) {}
+
+		[[nodiscard]]
+		ArenaT& arena()const noexcept {
+			return *arena_;
+		}
+
+	private:
+		void* do_allocate(std::size_t nbytes, std::size_t align)override {
+			return arena_->Allocate(nbytes, align);
+		}
+		void do_deallocate(void* mem, std::size_t nbytes, std::size_t align)override {
+			arena_->Deallocate(mem, nbytes, align);
+		}
+		bool do_is_equal(std::pmr::memory_resource const& other)const noexcept override {
+			auto const* o = dynamic_cast<BasicArenaResource const*>(&other);
+			return o != nullptr && o->arena_ == arena_;
+		}
+
+		ArenaT* arena_;
+	};
+
+	using ArenaResource = BasicArenaResource<Arena>;
+	using ThreadSafeArenaResource = BasicArenaResource<ThreadSafeArena>;
+#endif //__cpp_lib_memory_resource
+
+}//end megu
@@ -0,0 +1,888 @@
+#pragma once
+#include "arena.hpp"
+#include <array>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+//containers that also run during constant evaluation need C++20 (constexpr destructors, std::construct_at)
+#if __cplusplus >= 202002L
+#define MEGU_CONSTEXPR20 constexpr
+#else
+#define MEGU_CONSTEXPR20
+#endif
+
+namespace megu {
+	namespace detail {
+		template<typename T>
+		[[nodiscard]]
+		constexpr std::size_t grown_capacity(std::size_t cap, std::size_t need)noexcept {
+			std::size_t const min_cap = sizeof(T) >= 64 ? 1 : 64 / sizeof(T);
+			return std::max({ need, cap * 2, min_cap });
+		}
+
+		template<typename T, typename...Args>
+		MEGU_CONSTEXPR20 T* construct_element(T* at, Args&&...args) {
+#if __cplusplus >= 202002L
+			return std::construct_at(at, std::forward<Args>(args)...);
+#else
+			return ::new(static_cast<void*>(at)) T(std::forward<Args>(args)...);
+#endif
+		}
+
+		//storage of containers without an arena and of every container during constant evaluation,
+		//where the arena's region machinery can not run
+		template<typename T>
+		[[nodiscard]]
+		MEGU_CONSTEXPR20 T* std_grow(T* mem, std::size_t count, std::size_t cap, std::size_t new_cap) {
+			std::allocator<T> alloc;
+			T* fresh = alloc.allocate(new_cap);
+			std::size_t i = 0;
+			try {
+				for (; i < count; ++i) {
+					construct_element(fresh + i, std::move_if_noexcept(mem[i]));
+				}
+			}
+			catch (...) {
+				while (i-- > 0) {
+					fresh[i].~T();
+				}
+				alloc.deallocate(fresh, new_cap);
+				throw;
+			}
+			for (i = 0; i < count; ++i) {
+				mem[i].~T();
+			}
+			if (mem != nullptr) {
+				alloc.deallocate(mem, cap);
+			}
+			return fresh;
+		}
+
+		//grows a block of count live T with room for cap to new_cap elements. trivially copyable elements go through
+		//ReallocateNoThrow, which extends the block in place when it is the last one in its region and copies
+		//otherwise, anything else is moved into a fresh block. throws std::bad_alloc with the old block untouched.
+		//a null arena means std::allocator
+		template<typename T, typename ArenaT>
+		[[nodiscard]]
+		MEGU_CONSTEXPR20 T* arena_grow(ArenaT* arena_ptr, T* mem, std::size_t count, std::size_t cap, std::size_t new_cap) {
+			if (new_cap > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+				throw std::bad_array_new_length();
+			}
+			if (arena_ptr == nullptr || constant_evaluated()) {
+				return std_grow(mem, count, cap, new_cap);
+			}
+			ArenaT& arena = *arena_ptr;
+			if constexpr (std::is_trivially_copyable_v<T>) {
+				void* remem = mem == nullptr
+					? arena.AllocateNoThrow(new_cap * sizeof(T), alignof(T))
+					: arena.ReallocateNoThrow(mem, cap * sizeof(T), new_cap * sizeof(T), alignof(T));
+				if (remem == nullptr) {
+					throw std::bad_alloc();
+				}
+				return static_cast<T*>(remem);
+			}
+			else {
+				T* fresh = static_cast<T*>(arena.Allocate(new_cap * sizeof(T), alignof(T)));
+				std::size_t i = 0;
+				try {
+					for (; i < count; ++i) {
+						::new(static_cast<void*>(fresh + i)) T(std::move_if_noexcept(mem[i]));
+					}
+				}
+				catch (...) {
+					while (i-- > 0) {
+						fresh[i].~T();
+					}
+					arena.Deallocate(fresh, new_cap * sizeof(T), alignof(T));
+					throw;
+				}
+				for (i = 0; i < count; ++i) {
+					mem[i].~T();
+				}
+				if (mem != nullptr) {
+					arena.Deallocate(mem, cap * sizeof(T), alignof(T));
+				}
+				return fresh;
+			}
+		}
+
+		template<typename T, typename ArenaT>
+		MEGU_CONSTEXPR20 void arena_release(ArenaT* arena, T* mem, std::size_t cap)noexcept {
+			if (arena == nullptr || constant_evaluated()) {
+				std::allocator<T>().deallocate(mem, cap);
+				return;
+			}
+			arena->Deallocate(mem, cap * sizeof(T), alignof(T));
+		}
+	}//end detail
+
+	//vector whose storage lives in an arena. growing reallocates through the arena so the most recently grown vector
+	//of trivially copyable elements extends its block in place without copying, other vectors grow geometrically.
+	//the arena must outlive the vector, copies share it. a vector made without an arena uses std::allocator,
+	//and so does every vector during constant evaluation, which is how they build tables at compile time (see Freeze)
+	template<typename T, typename ArenaT = Arena>
+	class ArenaVector {
+	public:
+		using value_type = T;
+		using size_type = std::size_t;
+		using difference_type = std::ptrdiff_t;
+		using reference = T&;
+		using const_reference = T const&;
+		using pointer = T*;
+		using const_pointer = T const*;
+		using iterator = T*;
+		using const_iterator = T const*;
+
+		constexpr ArenaVector()noexcept
+			:arena_(nullptr), data_(nullptr), size_(0), cap_(0) {}
+		constexpr explicit ArenaVector(ArenaT& arena)noexcept
+			:arena_(&arena), data_(nullptr), size_(0), cap_(0) {}
+		MEGU_CONSTEXPR20 ArenaVector(ArenaT& arena, std::size_t count, T const& value = T())
+			:ArenaVector(arena) {
+			resize(count, value);
+		}
+		MEGU_CONSTEXPR20 ArenaVector(ArenaT& arena, std::initializer_list<T> init)
+			:ArenaVector(arena) {
+			append(init.begin(), init.end());
+		}
+		MEGU_CONSTEXPR20 ArenaVector(std::initializer_list<T> init)
+			:ArenaVector() {
+			append(init.begin(), init.end());
+		}
+
+		MEGU_CONSTEXPR20 ArenaVector(ArenaVector const& other)
+			:arena_(other.arena_), data_(nullptr), size_(0), cap_(0) {
+			append(other.begin(), other.end());
+		}
+		constexpr ArenaVector(ArenaVector&& other)noexcept
+			:arena_(other.arena_), data_(other.data_), size_(other.size_), cap_(other.cap_) {
+			other.data_ = nullptr;
+			other.size_ = 0;
+			other.cap_ = 0;
+		}
+		MEGU_CONSTEXPR20 ArenaVector& operator=(ArenaVector const& other) {
+			if (this != &other) {
+				clear();
+				append(other.begin(), other.end());
+			}
+			return *this;
+		}
+		//keeps its own arena, elements are moved one by one when the arenas differ
+		MEGU_CONSTEXPR20 ArenaVector& operator=(ArenaVector&& other) {
+			if (this == &other) {
+				return *this;
+			}
+			if (arena_ != other.arena_) {
+				clear();
+				append(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+				other.clear();
+				return *this;
+			}
+			release_storage();
+			data_ = other.data_;
+			size_ = other.size_;
+			cap_ = other.cap_;
+			other.data_ = nullptr;
+			other.size_ = 0;
+			other.cap_ = 0;
+			return *this;
+		}
+
+		MEGU_CONSTEXPR20 ~ArenaVector() {
+			release_storage();
+		}
+
+		template<typename...Args>
+		MEGU_CONSTEXPR20 T& emplace_back(Args&&...args) {
+			if (size_ == cap_) {
+				//build first so args may alias the current elements
+				T tmp(std::forward<Args>(args)...);
+				grow_to(detail::grown_capacity<T>(cap_, size_ + 1));
+				detail::construct_element(data_ + size_, std::move(tmp));
+			}
+			else {
+				detail::construct_element(data_ + size_, std::forward<Args>(args)...);
+			}
+			return data_[size_++];
+		}
+		MEGU_CONSTEXPR20 void push_back(T const& value) {
+			emplace_back(value);
+		}
+		MEGU_CONSTEXPR20 void push_back(T&& value) {
+			emplace_back(std::move(value));
+		}
+		MEGU_CONSTEXPR20 void pop_back()noexcept {
+			--size_;//not inside the destructor call, gcc 12 loses the decrement there during constant evaluation
+			data_[size_].~T();
+		}
+
+		template<typename It>
+		MEGU_CONSTEXPR20 void append(It first, It last) {
+			if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>) {
+				std::size_t const n = static_cast<std::size_t>(std::distance(first, last));
+				if (size_ + n > cap_) {
+					grow_to(detail::grown_capacity<T>(cap_, size_ + n));
+				}
+				for (; first != last; ++first) {
+					detail::construct_element(data_ + size_, *first);
+					++size_;
+				}
+			}
+			else {
+				for (; first != last; ++first) {
+					emplace_back(*first);
+				}
+			}
+		}
+
+		MEGU_CONSTEXPR20 void reserve(std::size_t count) {
+			if (count > cap_) {
+				grow_to(count);
+			}
+		}
+		MEGU_CONSTEXPR20 void resize(std::size_t count) {
+			resize_with(count, [](T* at) { detail::construct_element(at); });
+		}
+		MEGU_CONSTEXPR20 void resize(std::size_t count, T const& value) {
+			resize_with(count, [&value](T* at) { detail::construct_element(at, value); });
+		}
+		MEGU_CONSTEXPR20 void clear()noexcept {
+			destroy_elements(0);
+		}
+		//gives the unused capacity back, which only returns memory to the arena when the block is its last one
+		MEGU_CONSTEXPR20 void shrink_to_fit()noexcept {
+			if constexpr (std::is_trivially_copyable_v<T>) {
+				if (data_ != nullptr && size_ < cap_) {
+					if (size_ == 0) {
+						release_storage();
+						return;
+					}
+					if (arena_ == nullptr || detail::constant_evaluated()) {
+						return;
+					}
+					void* remem = arena_->ReallocateNoThrow(data_, cap_ * sizeof(T), size_ * sizeof(T), alignof(T));
+					if (remem == data_) {
+						cap_ = size_;
+					}
+				}
+			}
+		}
+
+		[[nodiscard]]
+		constexpr std::size_t size()const noexcept {
+			return size_;
+		}
+		[[nodiscard]]
+		constexpr std::size_t capacity()const noexcept {
+			return cap_;
+		}
+		[[nodiscard]]
+		constexpr bool empty()const noexcept {
+			return size_ == 0;
+		}
+		[[nodiscard]]
+		constexpr T* data()noexcept {
+			return data_;
+		}
+		[[nodiscard]]
+		constexpr T const* data()const noexcept {
+			return data_;
+		}
+		//null for vectors made without an arena
+		[[nodiscard]]
+		constexpr ArenaT* arena()const noexcept {
+			return arena_;
+		}
+
+		constexpr T& operator[](std::size_t i)noexcept {
+			return data_[i];
+		}
+		constexpr T const& operator[](std::size_t i)const noexcept {
+			return data_[i];
+		}
+		constexpr T& front()noexcept {
+			return data_[0];
+		}
+		constexpr T const& front()const noexcept {
+			return data_[0];
+		}
+		constexpr T& back()noexcept {
+			return data_[size_ - 1];
+		}
+		constexpr T const& back()const noexcept {
+			return data_[size_ - 1];
+		}
+
+		constexpr iterator begin()noexcept {
+			return data_;
+		}
+		constexpr iterator end()noexcept {
+			return data_ + size_;
+		}
+		constexpr const_iterator begin()const noexcept {
+			return data_;
+		}
+		constexpr const_iterator end()const noexcept {
+			return data_ + size_;
+		}
+
+	private:
+		MEGU_CONSTEXPR20 void grow_to(std::size_t new_cap) {
+			data_ = detail::arena_grow(arena_, data_, size_, cap_, new_cap);
+			cap_ = new_cap;
+		}
+
+		template<typename Construct>
+		MEGU_CONSTEXPR20 void resize_with(std::size_t count, Construct construct) {
+			if (count <= size_) {
+				destroy_elements(count);
+				return;
+			}
+			if (count > cap_) {
+				grow_to(std::max(count, detail::grown_capacity<T>(cap_, 0)));
+			}
+			for (; size_ < count; ++size_) {
+				construct(data_ + size_);
+			}
+		}
+
+		MEGU_CONSTEXPR20 void destroy_elements(std::size_t from)noexcept {
+			if constexpr (!std::is_trivially_destructible_v<T>) {
+				for (std::size_t i = from; i < size_; ++i) {
+					data_[i].~T();
+				}
+			}
+			size_ = from;
+		}
+
+		MEGU_CONSTEXPR20 void release_storage()noexcept {
+			destroy_elements(0);
+			if (data_ != nullptr) {
+				detail::arena_release(arena_, data_, cap_);
+				data_ = nullptr;
+				cap_ = 0;
+			}
+		}
+
+		ArenaT* arena_;
+		T* data_;
+		std::size_t size_;
+		std::size_t cap_;
+	};
+
+	//null terminated string builder over an arena, appends grow the buffer in place when it is the arena's last block
+	template<typename CharT, typename ArenaT = Arena>
+	class BasicArenaString {
+	public:
+		using value_type = CharT;
+		using size_type = std::size_t;
+		using view_type = std::basic_string_view<CharT>;
+		using iterator = CharT*;
+		using const_iterator = CharT const*;
+
+		explicit BasicArenaString(ArenaT& arena)noexcept
+			:arena_(&arena), data_(nullptr), size_(0), cap_(0) {}
+		BasicArenaString(ArenaT& arena, view_type str)
+			:BasicArenaString(arena) {
+			append(str);
+		}
+
+		BasicArenaString(BasicArenaString const& other)
+			:BasicArenaString(*other.arena_, other.view()) {}
+		BasicArenaString(BasicArenaString&& other)noexcept
+			:arena_(other.arena_), data_(other.data_), size_(other.size_), cap_(other.cap_) {
+			other.data_ = nullptr;
+			other.size_ = 0;
+			other.cap_ = 0;
+		}
+		BasicArenaString& operator=(BasicArenaString const& other) {
+			if (this != &other) {
+				clear();
+				append(other.view());
+			}
+			return *this;
+		}
+		//keeps its own arena, the characters are copied when the arenas differ
+		BasicArenaString& operator=(BasicArenaString&& other) {
+			if (this == &other) {
+				return *this;
+			}
+			if (arena_ != other.arena_) {
+				clear();
+				append(other.view());
+				return *this;
+			}
+			release_storage();
+			data_ = other.data_;
+			size_ = other.size_;
+			cap_ = other.cap_;
+			other.data_ = nullptr;
+			other.size_ = 0;
+			other.cap_ = 0;
+			return *this;
+		}
+		BasicArenaString& operator=(view_type str) {
+			clear();
+			return append(str);
+		}
+
+		~BasicArenaString() {
+			release_storage();
+		}
+
+		BasicArenaString& append(view_type str) {
+			//str may point into this string, so remember where before the buffer moves
+			CharT const* src = str.data();
+			std::size_t const n = str.size();
+			if (n == 0) {
+				return *this;
+			}
+			if (size_ + n + 1 > cap_) {
+				bool const aliased = data_ != nullptr && src >= data_ && src < data_ + size_;
+				std::size_t const off = aliased ? static_cast<std::size_t>(src - data_) : 0;
+				grow_to(detail::grown_capacity<CharT>(cap_, size_ + n + 1));
+				if (aliased) {
+					src = data_ + off;
+				}
+			}
+			std::char_traits<CharT>::move(data_ + size_, src, n);
+			size_ += n;
+			data_[size_] = CharT();
+			return *this;
+		}
+		BasicArenaString& append(std::size_t count, CharT c) {
+			if (size_ + count + 1 > cap_) {
+				grow_to(detail::grown_capacity<CharT>(cap_, size_ + count + 1));
+			}
+			std::char_traits<CharT>::assign(data_ + size_, count, c);
+			size_ += count;
+			data_[size_] = CharT();
+			return *this;
+		}
+		void push_back(CharT c) {
+			if (size_ + 2 > cap_) {
+				grow_to(detail::grown_capacity<CharT>(cap_, size_ + 2));
+			}
+			data_[size_++] = c;
+			data_[size_] = CharT();
+		}
+		void pop_back()noexcept {
+			data_[--size_] = CharT();
+		}
+		BasicArenaString& operator+=(view_type str) {
+			return append(str);
+		}
+		BasicArenaString& operator+=(CharT c) {
+			push_back(c);
+			return *this;
+		}
+
+		void reserve(std::size_t count) {
+			if (count + 1 > cap_) {
+				grow_to(count + 1);
+			}
+		}
+		void resize(std::size_t count, CharT c = CharT()) {
+			if (count > size_) {
+				append(count - size_, c);
+				return;
+			}
+			size_ = count;
+			if (data_ != nullptr) {
+				data_[size_] = CharT();
+			}
+		}
+		void clear()noexcept {
+			resize(0);
+		}
+
+		[[nodiscard]]
+		std::size_t size()const noexcept {
+			return size_;
+		}
+		[[nodiscard]]
+		std::size_t length()const noexcept {
+			return size_;
+		}
+		[[nodiscard]]
+		std::size_t capacity()const noexcept {
+			return cap_ == 0 ? 0 : cap_ - 1;
+		}
+		[[nodiscard]]
+		bool empty()const noexcept {
+			return size_ == 0;
+		}
+		[[nodiscard]]
+		CharT const* c_str()const noexcept {
+			return data_ == nullptr ? empty_str() : data_;
+		}
+		[[nodiscard]]
+		CharT* data()noexcept {
+			return data_;
+		}
+		[[nodiscard]]
+		CharT const* data()const noexcept {
+			return c_str();
+		}
+		[[nodiscard]]
+		view_type view()const noexcept {
+			return view_type(c_str(), size_);
+		}
+		operator view_type()const noexcept {
+			return view();
+		}
+		[[nodiscard]]
+		ArenaT& arena()const noexcept {
+			return *arena_;
+		}
+
+		CharT& operator[](std::size_t i)noexcept {
+			return data_[i];
+		}
+		CharT const& operator[](std::size_t i)const noexcept {
+			return data_[i];
+		}
+		iterator begin()noexcept {
+			return data_;
+		}
+		iterator end()noexcept {
+			return data_ + size_;
+		}
+		const_iterator begin()const noexcept {
+			return c_str();
+		}
+		const_iterator end()const noexcept {
+			return c_str() + size_;
+		}
+
+		friend bool operator==(BasicArenaString const& a, view_type b)noexcept {
+			return a.view() == b;
+		}
+		friend bool operator!=(BasicArenaString const& a, view_type b)noexcept {
+			return a.view() != b;
+		}
+
+	private:
+		static CharT const* empty_str()noexcept {
+			static constexpr CharT empty[1]{};
+			return empty;
+		}
+
+		void grow_to(std::size_t new_cap) {
+			data_ = detail::arena_grow(arena_, data_, size_ + (data_ != nullptr), cap_, new_cap);
+			cap_ = new_cap;
+		}
+
+		void release_storage()noexcept {
+			if (data_ != nullptr) {
+				arena_->Deallocate(data_, cap_ * sizeof(CharT), alignof(CharT));
+				data_ = nullptr;
+				size_ = 0;
+				cap_ = 0;
+			}
+		}
+
+		ArenaT* arena_;
+		CharT* data_;
+		std::size_t size_;
+		std::size_t cap_;//characters including the terminator
+	};
+
+	using ArenaString = BasicArenaString<char>;
+
+	//hash usable during constant evaluation, std::hash is not: integers and enums are mixed with the splitmix64
+	//finalizer, anything convertible to a string view is hashed with FNV-1a over its characters
+	struct ConstexprHash {
+		using is_transparent = void;
+
+		template<typename K>
+		[[nodiscard]]
+		constexpr std::size_t operator()(K const& key)const noexcept {
+			if constexpr (std::is_integral_v<K> || std::is_enum_v<K>) {
+				uint64_t x = static_cast<uint64_t>(key);
+				x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+				x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+				return static_cast<std::size_t>(x ^ (x >> 31));
+			}
+			else {
+				return hash_chars(std::basic_string_view<typename char_type<K>::type>(key));
+			}
+		}
+
+	private:
+		template<typename K, typename = void>
+		struct char_type {
+			using type = char;
+		};
+		template<typename K>
+		struct char_type<K, std::void_t<typename K::value_type>> {
+			using type = typename K::value_type;
+		};
+
+		template<typename CharT>
+		static constexpr std::size_t hash_chars(std::basic_string_view<CharT> str)noexcept {
+			uint64_t h = 0xcbf29ce484222325ull;
+			for (CharT c : str) {
+				h = (h ^ static_cast<uint64_t>(c)) * 0x100000001b3ull;
+			}
+			return static_cast<std::size_t>(h);
+		}
+	};
+
+	//open addressing hash map over an arena. entries sit densely in insertion order, which is the iteration order,
+	//and a power of two table of entry numbers is probed linearly, erase swaps the last entry into the hole.
+	//like ArenaVector it falls back to std::allocator without an arena and during constant evaluation
+	template<typename K, typename V, typename Hash = ConstexprHash, typename KeyEqual = std::equal_to<>, typename ArenaT = Arena>
+	class ArenaHashMap {
+	public:
+		using key_type = K;
+		using mapped_type = V;
+		using value_type = std::pair<K, V>;
+		using hasher = Hash;
+		using key_equal = KeyEqual;
+		using iterator = value_type*;
+		using const_iterator = value_type const*;
+
+		constexpr ArenaHashMap()noexcept
+			:entries_(), index_() {}
+		constexpr explicit ArenaHashMap(ArenaT& arena)noexcept
+			:entries_(arena), index_(arena) {}
+		MEGU_CONSTEXPR20 ArenaHashMap(std::initializer_list<value_type> init)
+			:ArenaHashMap() {
+			for (auto const& kv : init) {
+				insert_or_assign(kv.first, kv.second);
+			}
+		}
+
+		template<typename...Args>
+		MEGU_CONSTEXPR20 std::pair<iterator, bool> try_emplace(K const& key, Args&&...args) {
+			if (iterator it = find(key); it != end()) {
+				return { it, false };
+			}
+			if (entries_.size() + 1 > index_.size() / 4 * 3) {
+				rehash(index_.empty() ? min_buckets : index_.size() * 2);
+			}
+			entries_.emplace_back(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+			index_[empty_slot(key)] = static_cast<uint32_t>(entries_.size());
+			return { &entries_.back(), true };
+		}
+		template<typename M>
+		MEGU_CONSTEXPR20 std::pair<iterator, bool> insert_or_assign(K const& key, M&& value) {
+			auto res = try_emplace(key, std::forward<M>(value));
+			if (!res.second) {
+				res.first->second = std::forward<M>(value);
+			}
+			return res;
+		}
+		MEGU_CONSTEXPR20 V& operator[](K const& key) {
+			return try_emplace(key).first->second;
+		}
+
+		template<typename Key>
+		[[nodiscard]]
+		constexpr iterator find(Key const& key)noexcept {
+			std::size_t const slot = find_slot(key);
+			return slot == npos ? end() : entries_.data() + index_[slot] - 1;
+		}
+		template<typename Key>
+		[[nodiscard]]
+		constexpr const_iterator find(Key const& key)const noexcept {
+			std::size_t const slot = find_slot(key);
+			return slot == npos ? end() : entries_.data() + index_[slot] - 1;
+		}
+		template<typename Key>
+		[[nodiscard]]
+		constexpr bool contains(Key const& key)const noexcept {
+			return find_slot(key) != npos;
+		}
+
+		template<typename Key>
+		MEGU_CONSTEXPR20 bool erase(Key const& key) {
+			std::size_t slot = find_slot(key);
+			if (slot == npos) {
+				return false;
+			}
+			std::size_t const hole = index_[slot] - 1;
+			//backward shift keeps every remaining entry reachable from its home slot
+			std::size_t const mask = index_.size() - 1;
+			for (std::size_t next = (slot + 1) & mask; index_[next] != 0; next = (next + 1) & mask) {
+				std::size_t const home = Hash{}(entries_[index_[next] - 1].first) & mask;
+				if (((next - home) & mask) >= ((next - slot) & mask)) {
+					index_[slot] = index_[next];
+					slot = next;
+				}
+			}
+			index_[slot] = 0;
+			std::size_t const last = entries_.size() - 1;
+			if (hole != last) {
+				index_[find_slot(entries_[last].first)] = static_cast<uint32_t>(hole + 1);
+				entries_[hole] = std::move(entries_[last]);
+			}
+			entries_.pop_back();
+			return true;
+		}
+
+		MEGU_CONSTEXPR20 void reserve(std::size_t count) {
+			std::size_t buckets = min_buckets;
+			while (buckets / 4 * 3 < count) {
+				buckets *= 2;
+			}
+			if (buckets > index_.size()) {
+				rehash(buckets);
+			}
+			entries_.reserve(count);
+		}
+		MEGU_CONSTEXPR20 void clear()noexcept {
+			entries_.clear();
+			for (auto& i : index_) {
+				i = 0;
+			}
+		}
+
+		[[nodiscard]]
+		constexpr std::size_t size()const noexcept {
+			return entries_.size();
+		}
+		[[nodiscard]]
+		constexpr bool empty()const noexcept {
+			return entries_.empty();
+		}
+		[[nodiscard]]
+		constexpr std::size_t bucket_count()const noexcept {
+			return index_.size();
+		}
+
+		constexpr iterator begin()noexcept {
+			return entries_.begin();
+		}
+		constexpr iterator end()noexcept {
+			return entries_.end();
+		}
+		constexpr const_iterator begin()const noexcept {
+			return entries_.begin();
+		}
+		constexpr const_iterator end()const noexcept {
+			return entries_.end();
+		}
+
+		//entry numbers plus one per bucket, 0 is an empty bucket. for freezing
+		[[nodiscard]]
+		constexpr uint32_t const* buckets()const noexcept {
+			return index_.data();
+		}
+
+	private:
+		static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+		static constexpr std::size_t min_buckets = 8;
+
+		template<typename Key>
+		[[nodiscard]]
+		constexpr std::size_t find_slot(Key const& key)const noexcept {
+			if (index_.empty()) {
+				return npos;
+			}
+			std::size_t const mask = index_.size() - 1;
+			for (std::size_t i = Hash{}(key) & mask; index_[i] != 0; i = (i + 1) & mask) {
+				if (KeyEqual{}(entries_[index_[i] - 1].first, key)) {
+					return i;
+				}
+			}
+			return npos;
+		}
+		[[nodiscard]]
+		constexpr std::size_t empty_slot(K const& key)const noexcept {
+			std::size_t const mask = index_.size() - 1;
+			std::size_t i = Hash{}(key) & mask;
+			while (index_[i] != 0) {
+				i = (i + 1) & mask;
+			}
+			return i;
+		}
+
+		MEGU_CONSTEXPR20 void rehash(std::size_t buckets) {
+			index_.clear();
+			index_.resize(buckets, 0);
+			for (std::size_t e = 0; e < entries_.size(); ++e) {
+				index_[empty_slot(entries_[e].first)] = static_cast<uint32_t>(e + 1);
+			}
+		}
+
+		ArenaVector<value_type, ArenaT> entries_;
+		ArenaVector<uint32_t, ArenaT> index_;
+	};
+
+#if __cplusplus >= 202002L
+	//read only result of FreezeMap, the table ArenaHashMap built laid out in arrays that end up in read only data
+	template<typename K, typename V, std::size_t N, std::size_t Buckets, typename Hash = ConstexprHash, typename KeyEqual = std::equal_to<>>
+	struct FrozenHashMap {
+		using value_type = std::pair<K, V>;
+		using const_iterator = value_type const*;
+
+		template<typename Key>
+		[[nodiscard]]
+		constexpr const_iterator find(Key const& key)const noexcept {
+			if constexpr (Buckets != 0) {
+				for (std::size_t i = Hash{}(key) & (Buckets - 1); index_[i] != 0; i = (i + 1) & (Buckets - 1)) {
+					if (KeyEqual{}(entries_[index_[i] - 1].first, key)) {
+						return entries_.data() + index_[i] - 1;
+					}
+				}
+			}
+			return end();
+		}
+		template<typename Key>
+		[[nodiscard]]
+		constexpr bool contains(Key const& key)const noexcept {
+			return find(key) != end();
+		}
+		[[nodiscard]]
+		constexpr std::size_t size()const noexcept {
+			return N;
+		}
+		constexpr const_iterator begin()const noexcept {
+			return entries_.data();
+		}
+		constexpr const_iterator end()const noexcept {
+			return entries_.data() + N;
+		}
+
+		std::array<value_type, N> entries_;
+		std::array<uint32_t, Buckets> index_;
+	};
+
+	//runs Build during compilation and copies the container it returns into an std::array, so a table built with
+	//ArenaVector (or anything with size() and iterators) becomes static data instead of startup work:
+	//static constexpr auto table = megu::Freeze<[] { megu::ArenaVector<int> v; ...; return v; }>();
+	//Build runs twice, once for the size and once for the elements, and the elements must be default constructible
+	template<auto Build>
+	[[nodiscard]]
+	consteval auto Freeze() {
+		using container_t = decltype(Build());
+		constexpr std::size_t n = Build().size();
+		std::array<typename container_t::value_type, n> out{};
+		container_t const built = Build();
+		std::copy(built.begin(), built.end(), out.begin());
+		return out;
+	}
+
+	//Freeze for an ArenaHashMap, lookups in the result probe the same table the map had
+	template<auto Build>
+	[[nodiscard]]
+	consteval auto FreezeMap() {
+		using map_t = decltype(Build());
+		constexpr std::size_t n = Build().size();
+		constexpr std::size_t buckets = Build().bucket_count();
+		FrozenHashMap<typename map_t::key_type, typename map_t::mapped_type, n, buckets,
+			typename map_t::hasher, typename map_t::key_equal> out{};
+		map_t const built = Build();
+		std::copy(built.begin(), built.end(), out.entries_.begin());
+		std::copy(built.buckets(), built.buckets() + buckets, out.index_.begin());
+		return out;
+	}
+#endif
+
+}//end megu
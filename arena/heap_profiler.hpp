@@ -0,0 +1,340 @@
+#pragma once
+#include "alloc.hpp"
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <fstream>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#ifndef _WIN32
+#include <execinfo.h>
+#include <dlfcn.h>
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#include <cxxabi.h>
+#endif
+
+namespace megu {
+	namespace detail {
+		struct heap_sampler_t;
+	}
+
+	//samples allocations like tcmalloc's heap sampler, the owners it is attached to (Arena::SetHeapProfiler,
+	//GarbageCollector::SetHeapProfiler) record a stack trace about every sample_period bytes they hand out, the gap to
+	//the next sample is drawn from an exponential distribution so every byte is equally likely to be picked.
+	//sampled blocks still alive make up the in use profile, every sampled block the allocated one, both are scaled
+	//back up to estimates of the whole heap on export.
+	//can be shared by any number of owners on any threads and must outlive all of them
+	class HeapProfiler {
+	public:
+		static constexpr std::size_t max_depth = 64;
+
+		explicit HeapProfiler(std::size_t sample_period = (1 << 19))noexcept
+			:period_(sample_period == 0 ? 1 : sample_period), rng_(0x9e3779b97f4a7c15ull) {}
+
+		HeapProfiler(HeapProfiler const&) = delete;
+		HeapProfiler(HeapProfiler&&) = delete;
+		HeapProfiler& operator=(HeapProfiler const&) = delete;
+		HeapProfiler& operator=(HeapProfiler&&) = delete;
+
+		//mean bytes between two samples, owners pick it up from their next sample on
+		void SetSamplePeriod(std::size_t sample_period)noexcept {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			period_ = sample_period == 0 ? 1 : sample_period;
+		}
+		[[nodiscard]]
+		std::size_t GetSamplePeriod()noexcept {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			return period_;
+		}
+
+		//sampled blocks still alive
+		[[nodiscard]]
+		std::size_t NumLiveSamples()noexcept {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			std::size_t n = 0;
+			for (auto const& s : stacks_) {
+				n += s.live_objs_;
+			}
+			return n;
+		}
+
+		//one line per call site, frames from the outermost caller to the allocation separated by ';' and the estimated
+		//bytes after a space, as flamegraph.pl and speedscope read it. in_use = false reports everything allocated
+		std::string DumpFolded(bool in_use = true) {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			std::ostringstream ss;
+			for (auto const& s : stacks_) {
+				double const bytes = in_use ? s.live_est_ : s.alloc_est_;
+				if (bytes < 0.5) {
+					continue;
+				}
+				for (std::size_t i = s.frames_.size(); i-- > 0;) {
+					ss << symbol_name(s.frames_[i]) << (i == 0 ? ' ' : ';');
+				}
+				ss << static_cast<uint64_t>(std::llround(bytes)) << "\n";
+			}
+			return ss.str();
+		}
+
+		//legacy heap profile text format (heap_v2) with the raw sample counts, `pprof binary profile` symbolizes it
+		//against the mapped libraries listed at the end and scales the counts itself
+		std::string DumpPprof() {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			std::ostringstream ss;
+			uint64_t live_objs = 0, live_bytes = 0, alloc_objs = 0, alloc_bytes = 0;
+			for (auto const& s : stacks_) {
+				live_objs += s.live_objs_;
+				live_bytes += s.live_bytes_;
+				alloc_objs += s.alloc_objs_;
+				alloc_bytes += s.alloc_bytes_;
+			}
+			ss << "heap profile: " << live_objs << ": " << live_bytes << " [" << alloc_objs << ": " << alloc_bytes
+				<< "] @ heap_v2/" << period_ << "\n";
+			for (auto const& s : stacks_) {
+				if (s.alloc_objs_ == 0) {
+					continue;
+				}
+				ss << s.live_objs_ << ": " << s.live_bytes_ << " [" << s.alloc_objs_ << ": " << s.alloc_bytes_ << "] @";
+				for (void* pc : s.frames_) {
+					ss << " 0x" << std::hex << reinterpret_cast<uintptr_t>(pc) << std::dec;
+				}
+				ss << "\n";
+			}
+#ifdef __linux__
+			std::ifstream maps("/proc/self/maps");
+			if (maps) {
+				ss << "\nMAPPED_LIBRARIES:\n" << maps.rdbuf();
+			}
+#endif //__linux__
+			return ss.str();
+		}
+
+		//forgets what was allocated so far, blocks still alive stay in the in use profile
+		void ResetAllocated()noexcept {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			for (auto& s : stacks_) {
+				s.alloc_objs_ = s.live_objs_;
+				s.alloc_bytes_ = s.live_bytes_;
+				s.alloc_est_ = s.live_est_;
+			}
+		}
+
+	private:
+		friend struct detail::heap_sampler_t;
+
+		struct stack_t {
+			std::vector<void*> frames_;//innermost first
+			uint64_t live_objs_{ 0 };
+			uint64_t live_bytes_{ 0 };
+			uint64_t alloc_objs_{ 0 };
+			uint64_t alloc_bytes_{ 0 };
+			double live_est_{ 0 };//bytes scaled by the inverse of their sampling probability
+			double alloc_est_{ 0 };
+		};
+
+		//takes a sample of nbytes, returns its stack and sets weight to the bytes it stands for
+		uint32_t record(void* const* frames, std::size_t depth, std::size_t nbytes, double& weight) {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			std::vector<void*> key(frames, frames + depth);
+			auto [it, fresh] = index_.try_emplace(std::move(key), static_cast<uint32_t>(stacks_.size()));
+			if (fresh) {
+				stacks_.push_back(stack_t{ it->first });
+			}
+			double const p = -std::expm1(-static_cast<double>(nbytes) / static_cast<double>(period_));
+			weight = p > 0 ? static_cast<double>(nbytes) / p : static_cast<double>(nbytes);
+			stack_t& s = stacks_[it->second];
+			s.live_objs_++;
+			s.live_bytes_ += nbytes;
+			s.alloc_objs_++;
+			s.alloc_bytes_ += nbytes;
+			s.live_est_ += weight;
+			s.alloc_est_ += weight;
+			return it->second;
+		}
+		void release(uint32_t stack, std::size_t nbytes, double weight)noexcept {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			stack_t& s = stacks_[stack];
+			s.live_objs_--;
+			s.live_bytes_ -= nbytes;
+			s.live_est_ -= weight;
+		}
+
+		//bytes to the next sample, exponentially distributed around the period
+		std::size_t next_interval()noexcept {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			rng_ ^= rng_ << 13;
+			rng_ ^= rng_ >> 7;
+			rng_ ^= rng_ << 17;
+			double const u = (static_cast<double>(rng_ >> 11) + 1.0) / 9007199254740993.0;//(0, 1]
+			double const gap = -std::log(u) * static_cast<double>(period_);
+			return gap >= static_cast<double>(std::numeric_limits<std::size_t>::max()) ? std::numeric_limits<std::size_t>::max()
+				: static_cast<std::size_t>(gap) + 1;
+		}
+
+		static std::string symbol_name(void* pc) {
+			std::ostringstream ss;
+#ifndef _WIN32
+			Dl_info info;
+			//return addresses point past the call, one byte back is still inside the calling function
+			if (dladdr(static_cast<char*>(pc) - 1, &info) != 0 && info.dli_sname != nullptr) {
+#if defined(__GNUC__) || defined(__clang__)
+				int status = 0;
+				char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+				if (status == 0 && demangled != nullptr) {
+					std::string name(demangled);
+					std::free(demangled);
+					return name;
+				}
+#endif
+				return info.dli_sname;
+			}
+#endif // _WIN32
+			ss << pc;
+			return ss.str();
+		}
+
+		std::mutex mutex_;
+		std::size_t period_;
+		uint64_t rng_;
+		std::map<std::vector<void*>, uint32_t> index_;
+		std::vector<stack_t> stacks_;
+	};
+
+	namespace detail {
+		//the owner side, decides which allocations are sampled and remembers the sampled blocks until they are freed.
+		//as thread safe as the owner's allocation path, only the profiler it reports to is shared.
+		//the table of sampled blocks is made with the first sample so owners that never profile carry a null pointer
+		struct heap_sampler_t {
+			constexpr heap_sampler_t()noexcept
+				:profiler_(nullptr), countdown_(0), next_seq_(0), live_() {}
+			heap_sampler_t(heap_sampler_t const&) = delete;
+			heap_sampler_t& operator=(heap_sampler_t const&) = delete;
+
+			~heap_sampler_t() {
+				forget_since(0);
+			}
+
+			void set_profiler(HeapProfiler* profiler)noexcept {
+				forget_since(0);
+				profiler_ = profiler;
+				if (profiler_ != nullptr) {
+					countdown_ = profiler_->next_interval();
+				}
+			}
+			[[nodiscard]]
+			HeapProfiler* profiler()const noexcept {
+				return profiler_;
+			}
+
+			//the profiler check is all unprofiled owners pay
+			void on_alloc(void const* mem, std::size_t nbytes)noexcept {
+				if (profiler_ == nullptr || mem == nullptr) {
+					return;
+				}
+				if (nbytes < countdown_) {
+					countdown_ -= nbytes;
+					return;
+				}
+				sample(mem, nbytes);
+			}
+			void on_free(void const* mem)noexcept {
+				if (live_ == nullptr || live_->empty()) {
+					return;
+				}
+				auto it = live_->find(mem);
+				if (it == live_->end()) {
+					return;
+				}
+				profiler_->release(it->second.stack_, it->second.size_, it->second.weight_);
+				live_->erase(it);
+			}
+			void on_realloc(void const* mem, void const* remem, std::size_t news)noexcept {
+				if (remem == nullptr && news != 0) {//failed, mem is untouched
+					return;
+				}
+				on_free(mem);
+				on_alloc(remem, news);
+			}
+
+			//position to roll back to with forget_since, samples taken afterwards are newer
+			[[nodiscard]]
+			std::size_t seq()const noexcept {
+				return next_seq_;
+			}
+			//drops the samples of blocks freed in bulk
+			void forget_since(std::size_t seq)noexcept {
+				if (live_ == nullptr || live_->empty()) {
+					return;
+				}
+				for (auto it = live_->begin(); it != live_->end();) {
+					if (it->second.seq_ >= seq) {
+						profiler_->release(it->second.stack_, it->second.size_, it->second.weight_);
+						it = live_->erase(it);
+					}
+					else {
+						++it;
+					}
+				}
+			}
+
+		private:
+			struct sample_t {
+				uint32_t stack_;
+				std::size_t size_;
+				std::size_t seq_;
+				double weight_;
+			};
+
+			//kept out of line so its own frame is the only one to skip
+#if defined(__GNUC__) || defined(__clang__)
+			__attribute__((noinline))
+#elif defined(_MSC_VER)
+			__declspec(noinline)
+#endif
+			void sample(void const* mem, std::size_t nbytes)noexcept {
+				countdown_ = profiler_->next_interval();
+				void* frames[HeapProfiler::max_depth + 1];
+				std::size_t depth = 0;
+#ifdef _WIN32
+				depth = static_cast<std::size_t>(RtlCaptureStackBackTrace(1, HeapProfiler::max_depth, frames, nullptr));
+				void* const* first = frames;
+#else
+				depth = static_cast<std::size_t>(backtrace(frames, static_cast<int>(HeapProfiler::max_depth + 1)));
+				void* const* first = frames + (depth > 0 ? 1 : 0);//sample itself
+				depth = depth > 0 ? depth - 1 : 0;
+#endif // _WIN32
+				try {
+					if (live_ == nullptr) {
+						live_ = std::make_unique<std::unordered_map<void const*, sample_t>>();
+					}
+					auto [it, fresh] = live_->try_emplace(mem, sample_t{});
+					if (!fresh) {//the owner handed the block out again without us seeing it freed
+						profiler_->release(it->second.stack_, it->second.size_, it->second.weight_);
+					}
+					try {
+						double weight = 0;
+						uint32_t const stack = profiler_->record(first, depth, nbytes, weight);
+						it->second = sample_t{ stack, nbytes, next_seq_++, weight };
+					}
+					catch (...) {
+						live_->erase(it);
+						throw;
+					}
+				}
+				catch (...) {//out of memory while profiling, the sample is lost
+				}
+			}
+
+			HeapProfiler* profiler_;
+			std::size_t countdown_;//bytes left before the next sample
+			std::size_t next_seq_;
+			std::unique_ptr<std::unordered_map<void const*, sample_t>> live_;
+		};
+	}
+
+}//end megu
@@ -0,0 +1,212 @@
+#pragma once
+#include "arena.hpp"
+
+namespace megu {
+	template<std::size_t N, typename ArenaT>
+	class InlineArena;
+
+	//checkpoint returned by InlineArena::Mark, covers the inline buffer and the spill arena
+	class InlineArenaMark {
+	public:
+		constexpr InlineArenaMark()noexcept
+			:size_(0), allocs_(0), spill_() {}
+	private:
+		template<std::size_t, typename>
+		friend class InlineArena;
+
+		std::size_t size_;
+		uint32_t allocs_;
+		ArenaMark spill_;
+	};
+
+	//arena whose first N bytes live inside the object itself, so one on the stack serves small scratch work with no
+	//system allocation at all and only spills into the regions of an ArenaT once the buffer is exhausted.
+	//blocks in the buffer bump like VirtualArena, the back one grows and shrinks in place.
+	//it can not be copied or moved since handed out blocks may point into it.
+	//like the arena it spills into it only runs outside constant evaluation
+	template<std::size_t N, typename ArenaT = Arena>
+	class InlineArena {
+	public:
+		static constexpr std::size_t inline_capacity = N;
+
+		MEGU_CONSTEXPR InlineArena(std::size_t spill_cap = (1 << 12))noexcept
+			:size_(0), allocs_(0), spill_(spill_cap) {}
+		MEGU_CONSTEXPR InlineArena(GrowthPolicy growth)noexcept
+			:size_(0), allocs_(0), spill_(growth) {}
+
+		InlineArena(InlineArena const&) = delete;
+		InlineArena(InlineArena&&) = delete;
+		InlineArena& operator=(InlineArena const&) = delete;
+		InlineArena& operator=(InlineArena&&) = delete;
+
+		[[nodiscard]]
+		MEGU_CONSTEXPR
+		void* Allocate(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			if (void* mem = alloc_inline(nbytes, align)) {
+				return mem;
+			}
+			return spill_.Allocate(nbytes, align);
+		}
+		[[nodiscard]]
+		MEGU_CONSTEXPR
+		void* AllocateNoThrow(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			if (void* mem = alloc_inline(nbytes, align)) {
+				return mem;
+			}
+			return spill_.AllocateNoThrow(nbytes, align);
+		}
+
+		[[nodiscard]]
+		MEGU_CONSTEXPR
+		void* Reallocate(void* mem,
+			std::size_t old_size,
+			std::size_t new_size,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			void* remem = ReallocateNoThrow(mem, old_size, new_size, align);
+			if (remem == nullptr && new_size != 0) {
+				throw std::bad_alloc();
+			}
+			return remem;
+		}
+		[[nodiscard]]
+		MEGU_CONSTEXPR
+		void* ReallocateNoThrow(void* mem,
+			std::size_t old_size,
+			std::size_t new_size,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			if (mem == nullptr) {
+				return AllocateNoThrow(new_size, align);
+			}
+			if (!in_buffer(mem)) {
+				return spill_.ReallocateNoThrow(mem, old_size, new_size, align);
+			}
+			if (new_size == 0) {
+				Deallocate(mem, old_size, align);
+				return nullptr;
+			}
+			if (is_back(mem, old_size) && detail::alignment_offset(align, mem) == 0) {
+				std::size_t const off = static_cast<std::size_t>(static_cast<unsigned char*>(mem) - buffer_);
+				if (new_size <= N - off) {
+					size_ = off + new_size;
+					return mem;
+				}
+			}
+			else if (new_size <= old_size) {
+				return mem;
+			}
+			void* remem = AllocateNoThrow(new_size, align);
+			if (remem == nullptr) {
+				return nullptr;
+			}
+			std::memcpy(remem, mem, std::min(old_size, new_size));
+			Deallocate(mem, old_size, align);
+			return remem;
+		}
+
+		MEGU_CONSTEXPR
+		void Deallocate(void* mem,
+			std::size_t nbytes,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			if (!in_buffer(mem)) {
+				return spill_.Deallocate(mem, nbytes, align);
+			}
+			if (--allocs_ == 0) {
+				size_ = 0;
+				return;
+			}
+			if (is_back(mem, nbytes)) {
+				size_ -= nbytes;
+			}
+		}
+
+		//Rewind(Mark()) frees everything allocated in between in the buffer and in the spill arena, marks nest like a stack
+		[[nodiscard]]
+		MEGU_CONSTEXPR InlineArenaMark Mark()noexcept {
+			InlineArenaMark m;
+			m.size_ = size_;
+			m.allocs_ = allocs_;
+			m.spill_ = spill_.Mark();
+			return m;
+		}
+		MEGU_CONSTEXPR void Rewind(InlineArenaMark const& m)noexcept {
+			spill_.Rewind(m.spill_);
+			size_ = std::min(size_, m.size_);
+			allocs_ = std::min(allocs_, m.allocs_);
+			if (allocs_ == 0) {
+				size_ = 0;
+			}
+		}
+
+		//forgets every allocation, the spill regions are kept for reuse
+		MEGU_CONSTEXPR void ClearArena()noexcept {
+			size_ = 0;
+			allocs_ = 0;
+			spill_.ClearArena();
+		}
+		//forgets every allocation and frees the spill regions
+		MEGU_CONSTEXPR void FreeArena()noexcept {
+			size_ = 0;
+			allocs_ = 0;
+			spill_.FreeArena();
+		}
+
+		[[nodiscard]]
+		MEGU_CONSTEXPR bool InBuffer(void const* mem)const noexcept {
+			return in_buffer(mem);
+		}
+		//the arena blocks go to once the buffer is exhausted
+		[[nodiscard]]
+		constexpr ArenaT& Spill()noexcept {
+			return spill_;
+		}
+		[[nodiscard]]
+		constexpr std::size_t Size()const noexcept {
+			return size_;
+		}
+		[[nodiscard]]
+		constexpr std::size_t NumAllocations()const noexcept {
+			return allocs_;
+		}
+
+		std::string DumpUsage() {
+			std::ostringstream ss;
+			ss << "Dumping usage for inline arena : " << this << " {\n"
+				<< "  <total_allocs : " << allocs_ << ", reserved : " << size_
+				<< ", capacity : " << N << ", data-address : " << static_cast<void*>(buffer_) << ">\n}\n"
+				<< spill_.DumpUsage();
+			return ss.str();
+		}
+
+	private:
+		[[nodiscard]]
+		MEGU_CONSTEXPR void* alloc_inline(std::size_t nbytes, std::size_t align)noexcept {
+			std::size_t const aligned = detail::alignment_offset(align, buffer_ + size_);
+			if (nbytes > N - size_ || aligned > N - size_ - nbytes) {
+				return nullptr;
+			}
+			void* mem = buffer_ + size_ + aligned;
+			size_ += aligned + nbytes;
+			++allocs_;
+			return mem;
+		}
+
+		//by address rather than pointer comparison since mem is usually not in the buffer at all
+		[[nodiscard]]
+		MEGU_CONSTEXPR bool in_buffer(void const* mem)const noexcept {
+			uintptr_t const at = reinterpret_cast<uintptr_t>(mem);
+			uintptr_t const base = reinterpret_cast<uintptr_t>(buffer_);
+			return at >= base && at < base + N;
+		}
+
+		[[nodiscard]]
+		constexpr bool is_back(void const* mem, std::size_t nbytes)const noexcept {
+			return static_cast<unsigned char const*>(mem) + nbytes == buffer_ + size_;
+		}
+
+		alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) unsigned char buffer_[N];
+		std::size_t size_;
+		uint32_t allocs_;
+		ArenaT spill_;
+	};
+
+}//end megu
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace megu {
+	//pointer stored as the distance from its own address to the target, so a structure built out of them stays valid
+	//when the memory holding it is mapped at a different address (file backed or shared arenas).
+	//a zero distance is null, so zeroed memory reads as null pointers and a pointer can not point at itself.
+	//copies recompute the distance for their own address, it is not trivially copyable on purpose
+	template<typename T>
+	class OffsetPtr {
+	public:
+		using element_type = T;
+
+		OffsetPtr()noexcept
+			:off_(0) {}
+		OffsetPtr(std::nullptr_t)noexcept
+			:off_(0) {}
+		OffsetPtr(T* ptr)noexcept
+			:off_(distance_to(ptr)) {}
+		OffsetPtr(OffsetPtr const& other)noexcept
+			:off_(distance_to(other.get())) {}
+		template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+		OffsetPtr(OffsetPtr<U> const& other)noexcept
+			:off_(distance_to(static_cast<T*>(other.get()))) {}
+
+		OffsetPtr& operator=(OffsetPtr const& other)noexcept {
+			off_ = distance_to(other.get());
+			return *this;
+		}
+		OffsetPtr& operator=(T* ptr)noexcept {
+			off_ = distance_to(ptr);
+			return *this;
+		}
+		OffsetPtr& operator=(std::nullptr_t)noexcept {
+			off_ = 0;
+			return *this;
+		}
+
+		[[nodiscard]]
+		T* get()const noexcept {
+			if (off_ == 0) {
+				return nullptr;
+			}
+			return reinterpret_cast<T*>(reinterpret_cast<std::intptr_t>(this) + off_);
+		}
+		T* operator->()const noexcept {
+			return get();
+		}
+		template<typename U = T, typename = std::enable_if_t<!std::is_void_v<U>>>
+		U& operator*()const noexcept {
+			return *get();
+		}
+		template<typename U = T, typename = std::enable_if_t<!std::is_void_v<U>>>
+		U& operator[](std::ptrdiff_t i)const noexcept {
+			return get()[i];
+		}
+		explicit operator bool()const noexcept {
+			return off_ != 0;
+		}
+
+		friend bool operator==(OffsetPtr const& a, OffsetPtr const& b)noexcept {
+			return a.get() == b.get();
+		}
+		friend bool operator!=(OffsetPtr const& a, OffsetPtr const& b)noexcept {
+			return a.get() != b.get();
+		}
+		friend bool operator==(OffsetPtr const& a, std::nullptr_t)noexcept {
+			return a.off_ == 0;
+		}
+		friend bool operator!=(OffsetPtr const& a, std::nullptr_t)noexcept {
+			return a.off_ != 0;
+		}
+
+	private:
+		std::intptr_t distance_to(T const* ptr)const noexcept {
+			if (ptr == nullptr) {
+				return 0;
+			}
+			return reinterpret_cast<std::intptr_t>(ptr) - reinterpret_cast<std::intptr_t>(this);
+		}
+
+		std::intptr_t off_;
+	};
+
+}//end megu
@@ -0,0 +1,177 @@
+#pragma once
+#include "alloc.hpp"
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+namespace megu::detail {
+	//process wide three level radix tree mapping every 4KiB page of a region to the region that owns it.
+	//inner nodes are created lazily with CAS and live as long as the process, so lookups never take a lock
+	//and may run concurrently with registration of other regions.
+	//a page may only ever belong to one live region, which holds as long as regions start on a page boundary
+	class page_map_t {
+	public:
+		static constexpr unsigned page_shift = 12;
+		static constexpr std::size_t page_size = std::size_t(1) << page_shift;
+		static constexpr unsigned address_bits = sizeof(void*) == 8 ? 48 : 32;
+		static constexpr unsigned total_bits = address_bits - page_shift;
+		static constexpr unsigned leaf_bits = total_bits / 3;
+		static constexpr unsigned mid_bits = total_bits / 3;
+		static constexpr unsigned root_bits = total_bits - leaf_bits - mid_bits;
+
+		constexpr page_map_t()noexcept = default;
+		page_map_t(page_map_t const&) = delete;
+		page_map_t& operator=(page_map_t const&) = delete;
+
+		[[nodiscard]]
+		void* get(void const* mem)const noexcept {
+			uintptr_t const page = reinterpret_cast<uintptr_t>(mem) >> page_shift;
+			if (page >> total_bits) {
+				return nullptr;
+			}
+			mid_t* m = root_[root_index(page)].load(std::memory_order_acquire);
+			if (m == nullptr) {
+				return nullptr;
+			}
+			leaf_t* l = m->leaves_[mid_index(page)].load(std::memory_order_acquire);
+			if (l == nullptr) {
+				return nullptr;
+			}
+			return l->values_[leaf_index(page)].load(std::memory_order_acquire);
+		}
+
+		//maps every page overlapping [mem, mem + nbytes) to owner, fails only when a node can not be allocated
+		[[nodiscard]]
+		bool set(void const* mem, std::size_t nbytes, void* owner)noexcept {
+			if (nbytes == 0) {
+				return true;
+			}
+			uintptr_t const first = reinterpret_cast<uintptr_t>(mem) >> page_shift;
+			uintptr_t const last = (reinterpret_cast<uintptr_t>(mem) + nbytes - 1) >> page_shift;
+			if (last >> total_bits) {
+				return false;
+			}
+			leaf_t* l = nullptr;
+			for (uintptr_t page = first; page <= last; ++page) {
+				if (l == nullptr || leaf_index(page) == 0) {
+					l = ensure_leaf(page);
+					if (l == nullptr) {
+						store_pages(first, page, nullptr);
+						return false;
+					}
+				}
+				l->values_[leaf_index(page)].store(owner, std::memory_order_release);
+			}
+			return true;
+		}
+
+		//creates the nodes for every page overlapping [mem, mem + nbytes) without mapping any of them,
+		//so a later assign of the range can not fail. fails only when a node can not be allocated
+		[[nodiscard]]
+		bool reserve(void const* mem, std::size_t nbytes)noexcept {
+			if (nbytes == 0) {
+				return true;
+			}
+			uintptr_t const first = reinterpret_cast<uintptr_t>(mem) >> page_shift;
+			uintptr_t const last = (reinterpret_cast<uintptr_t>(mem) + nbytes - 1) >> page_shift;
+			if (last >> total_bits) {
+				return false;
+			}
+			for (uintptr_t page = first; page <= last; page = (page | ((uintptr_t(1) << leaf_bits) - 1)) + 1) {
+				if (ensure_leaf(page) == nullptr) {
+					return false;
+				}
+			}
+			return true;
+		}
+		//maps the pages of a range made ready with reserve to owner
+		void assign(void const* mem, std::size_t nbytes, void* owner)noexcept {
+			if (nbytes == 0) {
+				return;
+			}
+			uintptr_t const first = reinterpret_cast<uintptr_t>(mem) >> page_shift;
+			uintptr_t const last = (reinterpret_cast<uintptr_t>(mem) + nbytes - 1) >> page_shift;
+			if (last >> total_bits) {
+				return;
+			}
+			store_pages(first, last + 1, owner);
+		}
+
+		void clear(void const* mem, std::size_t nbytes)noexcept {
+			if (nbytes == 0) {
+				return;
+			}
+			uintptr_t const first = reinterpret_cast<uintptr_t>(mem) >> page_shift;
+			uintptr_t const last = (reinterpret_cast<uintptr_t>(mem) + nbytes - 1) >> page_shift;
+			if (last >> total_bits) {
+				return;
+			}
+			store_pages(first, last + 1, nullptr);
+		}
+
+	private:
+		struct leaf_t {
+			std::atomic<void*> values_[std::size_t(1) << leaf_bits];
+		};
+		struct mid_t {
+			std::atomic<leaf_t*> leaves_[std::size_t(1) << mid_bits];
+		};
+
+		static constexpr std::size_t root_index(uintptr_t page)noexcept {
+			return page >> (leaf_bits + mid_bits);
+		}
+		static constexpr std::size_t mid_index(uintptr_t page)noexcept {
+			return (page >> leaf_bits) & ((uintptr_t(1) << mid_bits) - 1);
+		}
+		static constexpr std::size_t leaf_index(uintptr_t page)noexcept {
+			return page & ((uintptr_t(1) << leaf_bits) - 1);
+		}
+
+		//only touches nodes that already exist, pages that were never set are already null
+		void store_pages(uintptr_t first, uintptr_t end, void* owner)noexcept {
+			for (uintptr_t page = first; page < end; ++page) {
+				mid_t* m = root_[root_index(page)].load(std::memory_order_acquire);
+				leaf_t* l = m ? m->leaves_[mid_index(page)].load(std::memory_order_acquire) : nullptr;
+				if (l == nullptr) {
+					continue;
+				}
+				l->values_[leaf_index(page)].store(owner, std::memory_order_release);
+			}
+		}
+
+		[[nodiscard]]
+		leaf_t* ensure_leaf(uintptr_t page)noexcept {
+			mid_t* m = ensure_node(root_[root_index(page)]);
+			if (m == nullptr) {
+				return nullptr;
+			}
+			return ensure_node(m->leaves_[mid_index(page)]);
+		}
+
+		template<typename Node>
+		[[nodiscard]]
+		static Node* ensure_node(std::atomic<Node*>& slot)noexcept {
+			Node* n = slot.load(std::memory_order_acquire);
+			if (n != nullptr) {
+				return n;
+			}
+			Node* fresh = new(std::nothrow) Node();
+			if (fresh == nullptr) {
+				return nullptr;
+			}
+			if (slot.compare_exchange_strong(n, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+				return fresh;
+			}
+			delete fresh;//someone else won the race
+			return n;
+		}
+
+		std::atomic<mid_t*> root_[std::size_t(1) << root_bits]{};
+	};
+
+	inline page_map_t& global_page_map()noexcept {
+		static page_map_t map;
+		return map;
+	}
+
+}//end megu::detail
@@ -0,0 +1,358 @@
+#pragma once
+#include "arena.hpp"
+#include "offset_ptr.hpp"
+#include <string_view>
+
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+namespace megu {
+	//arena living in a single shared mapping of a file, everything allocated in it is written to the file by the system
+	//and is there again when the file is opened by the next process, with no deserialization.
+	//the file may be mapped at another address each time so pointers stored inside must be OffsetPtr,
+	//and objects are found again through named roots. bookkeeping lives in the file header so it persists as well.
+	//allocations bump like VirtualArena, a new file is sized to the capacity up front (sparse where supported)
+	//and an existing one keeps its size unless a larger capacity is asked for.
+	//one open instance per file, nothing here synchronizes processes
+	class PersistentArena {
+	public:
+		static constexpr std::size_t max_roots = 32;
+		static constexpr std::size_t max_root_name = 55;
+
+		static constexpr std::size_t default_capacity = (std::size_t(1) << 30);
+
+		//capacity 0 creates missing or empty files with default_capacity and opens existing ones at their size.
+		//files that are not empty are never written to before their header checks out
+		PersistentArena(std::string const& path, std::size_t capacity = 0)noexcept
+			:base_(nullptr), header_(nullptr), mapped_(0), created_(false)
+		{
+			if (detail::SysFileSize(path.c_str()) == 0) {
+				if (!map_file(path, round_to_page(std::max(capacity == 0 ? default_capacity : capacity, min_capacity())))) {
+					return;
+				}
+				header_->version_ = version;
+				header_->data_offset_ = static_cast<uint32_t>(data_offset());
+				header_->size_ = 0;
+				header_->allocs_ = 0;
+				header_->magic_ = magic;
+				created_ = true;
+			}
+			else {
+				if (!map_file(path, 0) || !compatible()) {
+					release_mapping();//not ours or from an incompatible build, leave it alone
+					return;
+				}
+				if (capacity > mapped_) {
+					release_mapping();
+					if (!map_file(path, round_to_page(capacity)) || !compatible()) {
+						release_mapping();
+						return;
+					}
+				}
+			}
+			header_->capacity_ = mapped_;
+		}
+
+		PersistentArena(PersistentArena const&) = delete;
+		PersistentArena& operator=(PersistentArena const&) = delete;
+
+		PersistentArena(PersistentArena&& other)noexcept {
+			private_move(std::move(other));
+		}
+		PersistentArena& operator=(PersistentArena&& other)noexcept {
+			if (this != &other) {
+				release_mapping();
+				private_move(std::move(other));
+			}
+			return *this;
+		}
+
+		~PersistentArena() {
+			release_mapping();
+		}
+
+		[[nodiscard]]
+		void* Allocate(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			void* mem = alloc_nothrow(nbytes, align);
+			if (mem == nullptr) {
+				throw std::bad_alloc();
+			}
+			return mem;
+		}
+		[[nodiscard]]
+		void* AllocateNoThrow(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			return alloc_nothrow(nbytes, align);
+		}
+
+		[[nodiscard]]
+		void* Reallocate(void* mem,
+			std::size_t old_size,
+			std::size_t new_size,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			void* remem = realloc_nothrow(mem, old_size, new_size, align);
+			if (remem == nullptr) {
+				throw std::bad_alloc();
+			}
+			return remem;
+		}
+		[[nodiscard]]
+		void* ReallocateNoThrow(void* mem,
+			std::size_t old_size,
+			std::size_t new_size,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			return realloc_nothrow(mem, old_size, new_size, align);
+		}
+
+		void Deallocate(void* mem,
+			std::size_t nbytes,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			(void)align;
+			if (!Owns(mem)) {
+				return;
+			}
+			if (--header_->allocs_ == 0) {
+				header_->size_ = 0;
+				return;
+			}
+			if (is_back(mem, nbytes)) {
+				header_->size_ -= nbytes;
+			}
+		}
+
+		[[nodiscard]]
+		bool Owns(void const* mem)const noexcept {
+			return base_ != nullptr && mem >= data() && mem < data() + header_->size_;
+		}
+
+		//names obj so it can be found with GetRoot after the file is opened again, null removes the name.
+		//false when the name is too long, the table is full or obj is not in the arena
+		bool SetRoot(std::string_view name, void const* obj)noexcept {
+			if (base_ == nullptr || name.empty() || name.size() > max_root_name || (obj != nullptr && !Owns(obj))) {
+				return false;
+			}
+			root_t* slot = find_root(name);
+			if (obj == nullptr) {
+				if (slot != nullptr) {
+					*slot = root_t{};
+				}
+				return true;
+			}
+			if (slot == nullptr) {
+				for (auto& r : header_->roots_) {
+					if (r.offset_ == 0) {
+						slot = &r;
+						break;
+					}
+				}
+				if (slot == nullptr) {
+					return false;
+				}
+				std::memset(slot->name_, 0, sizeof(slot->name_));
+				std::memcpy(slot->name_, name.data(), name.size());
+			}
+			slot->offset_ = static_cast<uint64_t>(static_cast<char const*>(obj) - base_);
+			return true;
+		}
+		template<typename T = void>
+		[[nodiscard]]
+		T* GetRoot(std::string_view name)const noexcept {
+			if (base_ == nullptr) {
+				return nullptr;
+			}
+			root_t const* slot = find_root(name);
+			return slot == nullptr ? nullptr : reinterpret_cast<T*>(base_ + slot->offset_);
+		}
+
+		//forgets every allocation and every root, the file keeps its size
+		void ClearArena()noexcept {
+			if (base_ == nullptr) {
+				return;
+			}
+			header_->size_ = 0;
+			header_->allocs_ = 0;
+			for (auto& r : header_->roots_) {
+				r = root_t{};
+			}
+		}
+
+		//writes everything back to the file, the system does it eventually anyway, this is for durability points
+		bool Flush(bool async = false)noexcept {
+			if (base_ == nullptr) {
+				return false;
+			}
+			return detail::SysFlushFile(base_, round_to_page(data_offset() + header_->size_), async);
+		}
+
+		[[nodiscard]]
+		bool IsValid()const noexcept {
+			return base_ != nullptr;
+		}
+		//true when the file was new or empty, the caller has to build its contents
+		[[nodiscard]]
+		bool WasCreated()const noexcept {
+			return created_;
+		}
+		[[nodiscard]]
+		std::size_t Size()const noexcept {
+			return base_ ? static_cast<std::size_t>(header_->size_) : 0;
+		}
+		[[nodiscard]]
+		std::size_t Capacity()const noexcept {
+			return base_ ? mapped_ - data_offset() : 0;
+		}
+		[[nodiscard]]
+		std::size_t NumAllocations()const noexcept {
+			return base_ ? static_cast<std::size_t>(header_->allocs_) : 0;
+		}
+
+		std::string DumpUsage() {
+			std::ostringstream ss;
+			ss << "Dumping usage for persistent arena : " << this << " {\n"
+				<< "  <total_allocs : " << NumAllocations() << ", reserved : " << Size()
+				<< ", capacity : " << Capacity() << ", data-address : " << static_cast<void*>(data()) << ">\n";
+			if (base_ != nullptr) {
+				for (auto const& r : header_->roots_) {
+					if (r.offset_ != 0) {
+						ss << "  <root : " << r.name_ << ", data-address : " << static_cast<void*>(base_ + r.offset_) << ">\n";
+					}
+				}
+			}
+			ss << "}\n";
+			return ss.str();
+		}
+
+	private:
+		static constexpr uint64_t magic = 0x4e5241505547345dull;
+		static constexpr uint32_t version = 1;
+
+		struct root_t {
+			char name_[max_root_name + 1];
+			uint64_t offset_;//from the start of the file, 0 is a free slot
+		};
+		struct header_t {
+			uint64_t magic_;
+			uint32_t version_;
+			uint32_t data_offset_;
+			uint64_t capacity_;
+			uint64_t size_;
+			uint64_t allocs_;
+			root_t roots_[max_roots];
+		};
+
+		static constexpr std::size_t data_offset()noexcept {
+			return (sizeof(header_t) + 63) / 64 * 64;
+		}
+		[[nodiscard]]
+		static std::size_t min_capacity()noexcept {
+			return data_offset() + static_cast<std::size_t>(GetPageSize());
+		}
+
+		//bytes 0 maps the file at the size it has
+		[[nodiscard]]
+		bool map_file(std::string const& path, std::size_t bytes)noexcept {
+			std::size_t mapped = 0;
+			base_ = static_cast<char*>(detail::SysMapFile(path.c_str(), bytes, mapped, std::nothrow));
+			if (base_ == nullptr) {
+				return false;
+			}
+			mapped_ = mapped;
+			header_ = reinterpret_cast<header_t*>(base_);
+			return true;
+		}
+		//the mapping holds a header this build wrote and the bookkeeping in it fits the mapping
+		[[nodiscard]]
+		bool compatible()const noexcept {
+			return mapped_ >= min_capacity() && header_->magic_ == magic && header_->version_ == version
+				&& header_->data_offset_ == data_offset() && header_->size_ <= mapped_ - data_offset();
+		}
+
+		[[nodiscard]]
+		char* data()const noexcept {
+			return base_ == nullptr ? nullptr : base_ + data_offset();
+		}
+
+		[[nodiscard]]
+		void* alloc_nothrow(std::size_t nbytes, std::size_t align)noexcept {
+			//the mapping is only page aligned, anything stricter would not survive being mapped elsewhere
+			if (base_ == nullptr || align > static_cast<std::size_t>(GetPageSize())) {
+				return nullptr;
+			}
+			std::size_t const cap = Capacity();
+			std::size_t const size = static_cast<std::size_t>(header_->size_);
+			std::size_t const aligned = detail::alignment_offset(align, data() + size);
+			if (nbytes > cap - size || aligned > cap - size - nbytes) {
+				return nullptr;
+			}
+			void* mem = data() + size + aligned;
+			header_->size_ = size + aligned + nbytes;
+			header_->allocs_++;
+			return mem;
+		}
+
+		[[nodiscard]]
+		void* realloc_nothrow(void* mem, std::size_t olds, std::size_t news, std::size_t align)noexcept {
+			if (mem == nullptr) {
+				return alloc_nothrow(news, align);
+			}
+			if (is_back(mem, olds) && detail::alignment_offset(align, mem) == 0) {
+				std::size_t const off = static_cast<std::size_t>(static_cast<char*>(mem) - data());
+				if (news > Capacity() - off) {
+					return nullptr;
+				}
+				header_->size_ = off + news;
+				return mem;
+			}
+			void* remem = alloc_nothrow(news, align);
+			if (remem == nullptr) {
+				return nullptr;
+			}
+			std::memcpy(remem, mem, std::min(olds, news));
+			Deallocate(mem, olds, align);
+			return remem;
+		}
+
+		[[nodiscard]]
+		bool is_back(void const* mem, std::size_t nbytes)const noexcept {
+			return static_cast<char const*>(mem) + nbytes == data() + header_->size_;
+		}
+
+		[[nodiscard]]
+		root_t* find_root(std::string_view name)const noexcept {
+			for (auto& r : header_->roots_) {
+				if (r.offset_ != 0 && std::string_view(r.name_) == name) {
+					return &r;
+				}
+			}
+			return nullptr;
+		}
+
+		[[nodiscard]]
+		static std::size_t round_to_page(std::size_t n)noexcept {
+			std::size_t const pg = static_cast<std::size_t>(GetPageSize());
+			return (n + pg - 1) / pg * pg;
+		}
+
+		void release_mapping()noexcept {
+			if (base_ != nullptr) {
+				detail::SysUnmapFile(base_, mapped_);
+				base_ = nullptr;
+				header_ = nullptr;
+			}
+		}
+
+		void private_move(PersistentArena&& other)noexcept {
+			base_ = other.base_;
+			other.base_ = nullptr;
+			header_ = other.header_;
+			other.header_ = nullptr;
+			mapped_ = other.mapped_;
+			other.mapped_ = 0;
+			created_ = other.created_;
+		}
+
+		char* base_;
+		header_t* header_;//first bytes of the mapping
+		std::size_t mapped_;
+		bool created_;
+	};
+
+}//end megu
+#endif //MEGU_USE_CONSTEXPR_ALLOC
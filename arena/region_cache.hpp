@@ -0,0 +1,227 @@
+#pragma once
+#include "alloc.hpp"
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+
+namespace megu {
+	class RegionCache;
+}
+
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+namespace megu {
+	namespace detail {
+		struct region_factory_t;
+	}
+
+	//keeps the chunks of destroyed regions around so the next region of a compatible size skips mmap and the page faults.
+	//a chunk left unused for longer than the decay interval has its physical pages given back with madvise but keeps
+	//its address range, once more than max_bytes are cached the oldest chunks are unmapped for good.
+	//purging runs whenever the cache is touched and optionally from a background thread.
+	//can be shared by any number of arenas on any threads and must outlive all of them
+	class RegionCache {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		RegionCache(std::chrono::milliseconds decay = std::chrono::milliseconds(1000),
+			std::size_t max_bytes = (std::size_t(1) << 30),
+			bool lazy_purge = true)//MADV_FREE where the system has it, MADV_DONTNEED otherwise
+			:decay_(decay), max_bytes_(max_bytes), lazy_(lazy_purge) {}
+
+		RegionCache(RegionCache const&) = delete;
+		RegionCache(RegionCache&&) = delete;
+		RegionCache& operator=(RegionCache const&) = delete;
+		RegionCache& operator=(RegionCache&&) = delete;
+
+		~RegionCache() {
+			StopBackgroundPurge();
+			ReleaseAll();
+		}
+
+		void StartBackgroundPurge(std::chrono::milliseconds interval = std::chrono::milliseconds(100)) {
+			std::scoped_lock<std::mutex> lock(purger_mutex_);
+			if (purger_.joinable()) {
+				return;
+			}
+			stop_ = false;
+			purger_ = std::thread([this, interval] {
+				std::unique_lock<std::mutex> lock(purger_mutex_);
+				while (!purger_cv_.wait_for(lock, interval, [this] { return stop_; })) {
+					lock.unlock();
+					Purge();
+					lock.lock();
+				}
+			});
+		}
+		void StopBackgroundPurge() {
+			std::thread t;
+			{
+				std::scoped_lock<std::mutex> lock(purger_mutex_);
+				stop_ = true;
+				t = std::move(purger_);
+			}
+			purger_cv_.notify_all();
+			if (t.joinable()) {
+				t.join();
+			}
+		}
+
+		//returns the physical pages of every chunk idle for longer than the decay interval, returns the bytes purged
+		std::size_t Purge() {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			return purge_decayed(clock::now());
+		}
+		//unmaps every cached chunk
+		void ReleaseAll() {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			for (auto& c : chunks_) {
+				detail::SysFree(c.mem_, c.cap_);
+			}
+			chunks_.clear();
+			cached_ = 0;
+			resident_ = 0;
+		}
+
+		[[nodiscard]]
+		std::size_t CachedBytes() {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			return cached_;
+		}
+		//cached bytes that have not been purged yet and may still count towards RSS
+		[[nodiscard]]
+		std::size_t ResidentBytes() {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			return resident_;
+		}
+		[[nodiscard]]
+		std::size_t NumCached() {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			return chunks_.size();
+		}
+		[[nodiscard]]
+		std::size_t Hits() {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			return hits_;
+		}
+		[[nodiscard]]
+		std::size_t Misses() {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			return misses_;
+		}
+
+	private:
+		friend struct detail::region_factory_t;
+
+		struct chunk_t {
+			void* mem_;
+			std::size_t cap_;
+			HugePages_t pages_;
+			bool purged_;
+			clock::time_point freed_;
+		};
+
+		//only chunks that SysFree can give back are cached, aligned regions come from posix_memalign
+		[[nodiscard]]
+		static bool recyclable(std::size_t align, HugePages_t pages)noexcept {
+			if (pages != HugePages_t::NONE) {
+				return align <= static_cast<std::size_t>(GetHugePageSize());
+			}
+			return align <= static_cast<std::size_t>(GetPageSize());
+		}
+
+		//smallest cached chunk of the same kind that is at least bytes but not over twice that, null if none
+		[[nodiscard]]
+		void* take(std::size_t bytes, HugePages_t pages, std::size_t& capacity)noexcept {
+			std::scoped_lock<std::mutex> lock(mutex_);
+			if (pages != HugePages_t::NONE) {
+				std::size_t const hp = static_cast<std::size_t>(GetHugePageSize());
+				bytes = (bytes + hp - 1) & ~(hp - 1);
+			}
+			std::size_t best = chunks_.size();
+			for (std::size_t i = 0; i < chunks_.size(); ++i) {
+				auto const& c = chunks_[i];
+				if (c.pages_ == pages && c.cap_ >= bytes && c.cap_ / 2 <= bytes
+					&& (best == chunks_.size() || c.cap_ < chunks_[best].cap_)) {
+					best = i;
+				}
+			}
+			if (best == chunks_.size()) {
+				misses_++;
+				return nullptr;
+			}
+			chunk_t const c = chunks_[best];
+			chunks_.erase(chunks_.begin() + best);
+			cached_ -= c.cap_;
+			if (!c.purged_) {
+				resident_ -= c.cap_;
+			}
+			hits_++;
+			capacity = c.cap_;
+			return c.mem_;
+		}
+
+		void give(void* mem, std::size_t capacity, HugePages_t pages)noexcept {
+			auto const now = clock::now();
+			std::scoped_lock<std::mutex> lock(mutex_);
+			if (capacity > max_bytes_) {
+				detail::SysFree(mem, capacity);
+				return;
+			}
+			while (cached_ + capacity > max_bytes_) {//oldest first
+				detail::SysFree(chunks_.front().mem_, chunks_.front().cap_);
+				cached_ -= chunks_.front().cap_;
+				if (!chunks_.front().purged_) {
+					resident_ -= chunks_.front().cap_;
+				}
+				chunks_.erase(chunks_.begin());
+			}
+			//failing to grow the index just means the chunk goes back to the system
+			try {
+				chunks_.push_back(chunk_t{ mem, capacity, pages, false, now });
+			}
+			catch (...) {
+				detail::SysFree(mem, capacity);
+				return;
+			}
+			cached_ += capacity;
+			resident_ += capacity;
+			purge_decayed(now);
+		}
+
+		std::size_t purge_decayed(clock::time_point now)noexcept {//call with mutex_ held
+			std::size_t purged = 0;
+			for (auto& c : chunks_) {//chunks are in the order they were freed
+				if (now - c.freed_ < decay_) {
+					break;
+				}
+				if (!c.purged_) {
+					detail::SysPurge(c.mem_, c.cap_, lazy_);
+					c.purged_ = true;
+					resident_ -= c.cap_;
+					purged += c.cap_;
+				}
+			}
+			return purged;
+		}
+
+		std::chrono::milliseconds decay_;
+		std::size_t max_bytes_;
+		bool lazy_;
+
+		std::mutex mutex_;
+		std::vector<chunk_t> chunks_;
+		std::size_t cached_{ 0 };
+		std::size_t resident_{ 0 };
+		std::size_t hits_{ 0 };
+		std::size_t misses_{ 0 };
+
+		std::mutex purger_mutex_;
+		std::condition_variable purger_cv_;
+		std::thread purger_;
+		bool stop_{ false };
+	};
+
+}//end megu
+#endif //MEGU_USE_CONSTEXPR_ALLOC
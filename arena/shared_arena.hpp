@@ -0,0 +1,340 @@
+#pragma once
+#include "arena.hpp"
+#include "offset_ptr.hpp"
+
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+namespace megu {
+	//arena in a shared memory segment that any number of local processes map at the same time, so a producer
+	//allocates a buffer in place and hands the consumer only its offset. the bump pointer and the live allocation count
+	//live in the segment header and are updated with atomics like an atomic region, so Allocate/Deallocate are
+	//lock-free across threads and processes. every process maps the segment at its own address, store offsets
+	//(OffsetOf/FromOffset) or OffsetPtr in it, never raw pointers
+	class SharedArena {
+	public:
+		//creates the named segment, fails (IsValid() == false) when the name is already taken
+		SharedArena(std::string const& name, std::size_t capacity)noexcept
+			:SharedArena() {
+			std::size_t mapped = 0;
+			void* at = detail::SysMapShared(name.c_str(), round_to_page(std::max(capacity, min_capacity())), true, mapped, std::nothrow);
+			if (at != nullptr) {
+				name_ = name;
+				init(at, mapped);
+			}
+		}
+		//opens a segment created by another SharedArena, which must have finished constructing
+		explicit SharedArena(std::string const& name)noexcept
+			:SharedArena() {
+			std::size_t mapped = 0;
+			void* at = detail::SysMapShared(name.c_str(), 0, false, mapped, std::nothrow);
+			if (at != nullptr) {
+				name_ = name;
+				adopt(at, mapped);
+			}
+		}
+
+#ifndef _WIN32
+		//anonymous segment, reach it from other processes through Descriptor(), by fork or by passing the descriptor
+		[[nodiscard]]
+		static SharedArena Anonymous(std::size_t capacity)noexcept {
+			SharedArena arena;
+			capacity = round_to_page(std::max(capacity, min_capacity()));
+			int const fd = detail::SysCreateSharedDescriptor(capacity);
+			if (fd < 0) {
+				return arena;
+			}
+			std::size_t mapped = 0;
+			if (void* at = detail::SysMapDescriptor(fd, mapped, std::nothrow)) {
+				arena.fd_ = fd;
+				arena.init(at, mapped);
+			}
+			else {
+				close(fd);
+			}
+			return arena;
+		}
+		//maps the segment behind a descriptor received from the process that made it, the descriptor is not taken over
+		[[nodiscard]]
+		static SharedArena FromDescriptor(int fd)noexcept {
+			SharedArena arena;
+			std::size_t mapped = 0;
+			if (void* at = detail::SysMapDescriptor(fd, mapped, std::nothrow)) {
+				arena.adopt(at, mapped);
+			}
+			return arena;
+		}
+		//-1 for named segments and ones opened from a descriptor
+		[[nodiscard]]
+		int Descriptor()const noexcept {
+			return fd_;
+		}
+#endif // _WIN32
+
+		SharedArena(SharedArena const&) = delete;
+		SharedArena& operator=(SharedArena const&) = delete;
+
+		SharedArena(SharedArena&& other)noexcept {
+			private_move(std::move(other));
+		}
+		SharedArena& operator=(SharedArena&& other)noexcept {
+			if (this != &other) {
+				release_mapping();
+				private_move(std::move(other));
+			}
+			return *this;
+		}
+
+		//unmaps this process' view, the segment stays until every process has unmapped it and it is unlinked
+		~SharedArena() {
+			release_mapping();
+		}
+
+		//removes the name so no one else can open the segment, processes that mapped it keep using it
+		void Unlink()noexcept {
+			if (!name_.empty()) {
+				detail::SysUnlinkShared(name_.c_str());
+			}
+		}
+
+		[[nodiscard]]
+		void* Allocate(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			void* mem = alloc_nothrow(nbytes, align);
+			if (mem == nullptr) {
+				throw std::bad_alloc();
+			}
+			return mem;
+		}
+		[[nodiscard]]
+		void* AllocateNoThrow(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			return alloc_nothrow(nbytes, align);
+		}
+
+		[[nodiscard]]
+		void* Reallocate(void* mem,
+			std::size_t old_size,
+			std::size_t new_size,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			void* remem = realloc_nothrow(mem, old_size, new_size, align);
+			if (remem == nullptr) {
+				throw std::bad_alloc();
+			}
+			return remem;
+		}
+		[[nodiscard]]
+		void* ReallocateNoThrow(void* mem,
+			std::size_t old_size,
+			std::size_t new_size,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			return realloc_nothrow(mem, old_size, new_size, align);
+		}
+
+		//may be called by any process, not only the one that allocated mem
+		void Deallocate(void* mem,
+			std::size_t nbytes,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			(void)align;
+			if (!Owns(mem)) {
+				return;
+			}
+			if (header_->allocs_.fetch_sub(1) == 1) {
+				//last live block, rewind the whole segment unless someone reserved in the meantime
+				uint64_t sz = header_->size_.load();
+				if (header_->allocs_.load() == 0) {
+					header_->size_.compare_exchange_strong(sz, 0);
+				}
+				return;
+			}
+			//only succeeds if mem is still the last reservation
+			uint64_t end = OffsetOf(mem) - data_offset() + nbytes;
+			header_->size_.compare_exchange_strong(end, end - nbytes);
+		}
+
+		[[nodiscard]]
+		bool Owns(void const* mem)const noexcept {//bounded by capacity since the size may be rewound concurrently
+			return base_ != nullptr && mem >= base_ + data_offset() && mem < base_ + mapped_;
+		}
+
+		//position of mem in the segment, the same in every process that maps it
+		[[nodiscard]]
+		std::size_t OffsetOf(void const* mem)const noexcept {
+			return static_cast<std::size_t>(static_cast<char const*>(mem) - base_);
+		}
+		template<typename T = void>
+		[[nodiscard]]
+		T* FromOffset(std::size_t offset)const noexcept {
+			return reinterpret_cast<T*>(base_ + offset);
+		}
+
+		//forgets every allocation in every process, callers guarantee nothing in the segment is in use
+		void ClearArena()noexcept {
+			if (base_ == nullptr) {
+				return;
+			}
+			header_->allocs_.store(0);
+			header_->size_.store(0);
+		}
+
+		[[nodiscard]]
+		bool IsValid()const noexcept {
+			return base_ != nullptr;
+		}
+		[[nodiscard]]
+		std::size_t Size()const noexcept {
+			return base_ ? static_cast<std::size_t>(header_->size_.load(std::memory_order_relaxed)) : 0;
+		}
+		[[nodiscard]]
+		std::size_t Capacity()const noexcept {
+			return base_ ? mapped_ - data_offset() : 0;
+		}
+		[[nodiscard]]
+		std::size_t NumAllocations()const noexcept {
+			return base_ ? static_cast<std::size_t>(header_->allocs_.load(std::memory_order_relaxed)) : 0;
+		}
+
+		std::string DumpUsage() {
+			std::ostringstream ss;
+			ss << "Dumping usage for shared arena : " << this << " {\n"
+				<< "  <total_allocs : " << NumAllocations() << ", reserved : " << Size()
+				<< ", capacity : " << Capacity() << ", name : " << name_
+				<< ", data-address : " << static_cast<void*>(base_ ? base_ + data_offset() : nullptr) << ">\n}\n";
+			return ss.str();
+		}
+
+	private:
+		static constexpr uint64_t magic = 0x4e5241445248534dull;
+		static constexpr uint32_t version = 1;
+
+		//the same layout in every process, so only address free lock-free atomics go in here
+		struct header_t {
+			std::atomic<uint64_t> magic_;//stored last by the creator
+			uint32_t version_;
+			uint32_t data_offset_;
+			std::atomic<uint64_t> size_;
+			std::atomic<uint64_t> allocs_;
+		};
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared arenas need lock-free 64 bit atomics");
+
+		SharedArena()noexcept
+			:base_(nullptr), header_(nullptr), mapped_(0), fd_(-1), name_() {}
+
+		static constexpr std::size_t data_offset()noexcept {
+			return (sizeof(header_t) + 63) / 64 * 64;
+		}
+		static std::size_t min_capacity()noexcept {
+			return data_offset() + static_cast<std::size_t>(GetPageSize());
+		}
+		[[nodiscard]]
+		static std::size_t round_to_page(std::size_t n)noexcept {
+			std::size_t const pg = static_cast<std::size_t>(GetPageSize());
+			return (n + pg - 1) / pg * pg;
+		}
+
+		void init(void* at, std::size_t mapped)noexcept {
+			base_ = static_cast<char*>(at);
+			mapped_ = mapped;
+			header_ = ::new(at) header_t{};
+			header_->version_ = version;
+			header_->data_offset_ = static_cast<uint32_t>(data_offset());
+			header_->magic_.store(magic, std::memory_order_release);
+		}
+		void adopt(void* at, std::size_t mapped)noexcept {
+			auto* h = static_cast<header_t*>(at);
+			if (mapped < min_capacity() || h->magic_.load(std::memory_order_acquire) != magic
+				|| h->version_ != version || h->data_offset_ != data_offset()) {
+				detail::SysUnmapFile(at, mapped);
+				name_.clear();
+				return;
+			}
+			base_ = static_cast<char*>(at);
+			mapped_ = mapped;
+			header_ = h;
+		}
+
+		[[nodiscard]]
+		void* alloc_nothrow(std::size_t nbytes, std::size_t align)noexcept {
+			//offsets are aligned rather than addresses, which agree for any alignment up to the page size
+			if (base_ == nullptr || align > static_cast<std::size_t>(GetPageSize())) {
+				return nullptr;
+			}
+			std::size_t const cap = Capacity();
+			//count the reservation before publishing it so a concurrent free of the last block
+			//can never rewind the segment underneath us
+			header_->allocs_.fetch_add(1);
+			uint64_t old = header_->size_.load(std::memory_order_relaxed);
+			for (;;) {
+				std::size_t const at = data_offset() + static_cast<std::size_t>(old);
+				std::size_t const aligned = (align - at % align) % align;
+				if (nbytes > cap - old || aligned > cap - old - nbytes) {
+					header_->allocs_.fetch_sub(1);
+					return nullptr;
+				}
+				if (header_->size_.compare_exchange_weak(old, old + aligned + nbytes)) {
+					return base_ + at + aligned;
+				}
+			}
+		}
+
+		[[nodiscard]]
+		void* realloc_nothrow(void* mem, std::size_t olds, std::size_t news, std::size_t align)noexcept {
+			if (mem == nullptr) {
+				return alloc_nothrow(news, align);
+			}
+			if (!Owns(mem)) {
+				return nullptr;
+			}
+			if (news == 0) {
+				Deallocate(mem, olds, align);
+				return nullptr;
+			}
+			//grows or shrinks in place while mem is the last reservation
+			uint64_t end = OffsetOf(mem) - data_offset() + olds;
+			uint64_t const nend = end - olds + news;
+			if (nend <= Capacity() && header_->size_.compare_exchange_strong(end, nend)) {
+				return mem;
+			}
+			if (news <= olds) {
+				return mem;
+			}
+			void* remem = alloc_nothrow(news, align);
+			if (remem == nullptr) {
+				return nullptr;
+			}
+			std::memcpy(remem, mem, olds);
+			Deallocate(mem, olds, align);
+			return remem;
+		}
+
+		void release_mapping()noexcept {
+			if (base_ != nullptr) {
+				detail::SysUnmapFile(base_, mapped_);
+				base_ = nullptr;
+				header_ = nullptr;
+			}
+#ifndef _WIN32
+			if (fd_ >= 0) {
+				close(fd_);
+				fd_ = -1;
+			}
+#endif // _WIN32
+		}
+
+		void private_move(SharedArena&& other)noexcept {
+			base_ = other.base_;
+			other.base_ = nullptr;
+			header_ = other.header_;
+			other.header_ = nullptr;
+			mapped_ = other.mapped_;
+			other.mapped_ = 0;
+			fd_ = other.fd_;
+			other.fd_ = -1;
+			name_ = std::move(other.name_);
+		}
+
+		char* base_;
+		header_t* header_;//first bytes of the segment
+		std::size_t mapped_;
+		int fd_;
+		std::string name_;
+	};
+
+}//end megu
+#endif //MEGU_USE_CONSTEXPR_ALLOC
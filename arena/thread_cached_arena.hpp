@@ -0,0 +1,608 @@
+#pragma once
+#include "arena.hpp"
+#include <memory>
+
+namespace megu {
+	namespace detail {
+		struct thread_cache_t;
+
+		//written into a block that is freed by a thread other than its owner
+		struct remote_free_t {
+			remote_free_t* next_;
+			std::size_t nbytes_;
+		};
+
+		//region carved out of a shared ThreadSafeArena, the header lives at the start of the carved block
+		//and only the thread that currently owns it ever touches it.
+		//blocks are carved aligned to the arena's region capacity so a pointer masks down to its header
+		struct carved_region_t {
+			static constexpr std::size_t header_size()noexcept {
+				return (sizeof(carved_region_t) + __STDCPP_DEFAULT_NEW_ALIGNMENT__ - 1)
+					& ~(std::size_t(__STDCPP_DEFAULT_NEW_ALIGNMENT__) - 1);
+			}
+
+			[[nodiscard]]
+			static carved_region_t* create(void* block, std::size_t block_size, bool dedicated)noexcept {
+				return new(block) carved_region_t(block_size - header_size(), dedicated);
+			}
+
+			[[nodiscard]]
+			static carved_region_t* from_pointer(void const* mem, std::size_t region_cap)noexcept {
+				return reinterpret_cast<carved_region_t*>(reinterpret_cast<uintptr_t>(mem) & ~(uintptr_t(region_cap) - 1));
+			}
+
+			[[nodiscard]]
+			char* data()const noexcept {
+				return const_cast<char*>(reinterpret_cast<char const*>(this)) + header_size();
+			}
+			[[nodiscard]]
+			char* begin()const noexcept {
+				return data() + size_;
+			}
+			[[nodiscard]]
+			char* end()const noexcept {
+				return data() + cap_;
+			}
+			[[nodiscard]]
+			std::size_t capacity()const noexcept {
+				return cap_;
+			}
+			[[nodiscard]]
+			std::size_t block_size()const noexcept {
+				return cap_ + header_size();
+			}
+			[[nodiscard]]
+			std::size_t nallocations()const noexcept {
+				return allocs_;
+			}
+			[[nodiscard]]
+			bool is_dedicated()const noexcept {
+				return dedicated_;
+			}
+
+			[[nodiscard]]
+			bool in_region(void const* ptr)const noexcept {
+				return ptr >= data() && ptr < end();
+			}
+
+			[[nodiscard]]
+			void* try_reserve(std::size_t nbytes, std::size_t align)noexcept {
+				std::size_t const aligned = alignment_offset(align, begin());
+				if (size_ + aligned + nbytes > cap_) {
+					return nullptr;
+				}
+				void* ret = begin() + aligned;
+				size_ += aligned + nbytes;
+				allocs_++;
+				return ret;
+			}
+
+			[[nodiscard]]
+			bool try_resize_back(void const* mem, std::size_t olds, std::size_t news)noexcept {
+				if (begin() - olds != mem || size_ - olds + news > cap_) {
+					return false;
+				}
+				size_ = size_ - olds + news;
+				return true;
+			}
+
+			void free_reservation(void const* mem, std::size_t nbytes)noexcept {
+				rewind_back(mem, nbytes);
+				release(1);
+			}
+
+			void rewind_back(void const* mem, std::size_t nbytes)noexcept {
+				if (begin() - nbytes == mem) {
+					size_ -= nbytes;
+				}
+			}
+
+			//drops a batch of allocations at once, rewinding the region when none are left
+			void release(std::size_t count)noexcept {
+				assert(allocs_ >= count);
+				allocs_ -= count;
+				if (allocs_ == 0) {
+					size_ = 0;
+				}
+			}
+
+			void clear()noexcept {
+				size_ = 0;
+				allocs_ = 0;
+			}
+
+			carved_region_t* next_{ nullptr };
+			//read by any thread that frees into the region, null while the region sits in the shared pool
+			std::atomic<thread_cache_t*> owner_{ nullptr };
+
+		private:
+			carved_region_t(std::size_t cap, bool dedicated)noexcept
+				:cap_(cap), size_(0), allocs_(0), dedicated_(dedicated) {}
+
+			std::size_t cap_;
+			std::size_t size_;
+			std::size_t allocs_;
+			bool dedicated_;
+		};
+
+		//private region lists of one thread, head_ is the region being bumped,
+		//dedicated_ holds regions that were carved for a single oversized block
+		struct thread_cache_t {
+			void push_region(carved_region_t* r)noexcept {
+				carved_region_t*& list = r->is_dedicated() ? dedicated_ : head_;
+				r->owner_.store(this, std::memory_order_release);
+				r->next_ = list;
+				list = r;
+				nregions_++;
+			}
+
+			[[nodiscard]]
+			carved_region_t* empty_dedicated(std::size_t need)const noexcept {
+				for (auto* r = dedicated_; r != nullptr; r = r->next_) {
+					if (r->nallocations() == 0 && r->capacity() >= need) {
+						return r;
+					}
+				}
+				return nullptr;
+			}
+
+			//multi producer single consumer push, any thread may call it
+			void push_remote(void* mem, std::size_t nbytes)noexcept {
+				auto* node = new(mem) remote_free_t{ nullptr, nbytes };
+				remote_free_t* h = remote_frees_.load(std::memory_order_relaxed);
+				do {
+					node->next_ = h;
+				} while (!remote_frees_.compare_exchange_weak(h, node, std::memory_order_release, std::memory_order_relaxed));
+			}
+
+			[[nodiscard]]
+			bool has_remote_frees()const noexcept {
+				return remote_frees_.load(std::memory_order_relaxed) != nullptr;
+			}
+
+			//owner only, applies the queued frees batched per region
+			void drain_remote_frees(std::size_t region_cap)noexcept {
+				remote_free_t* n = remote_frees_.exchange(nullptr, std::memory_order_acquire);
+				carved_region_t* batch = nullptr;
+				std::size_t count = 0;
+				while (n != nullptr) {
+					remote_free_t* nxt = n->next_;
+					carved_region_t* r = carved_region_t::from_pointer(n, region_cap);
+					//fires when a remote free raced the owner's ClearArena and the region has moved on since
+					assert(r->owner_.load(std::memory_order_relaxed) == this);
+					if (r != batch) {
+						if (batch) {
+							batch->release(count);
+						}
+						batch = r;
+						count = 0;
+					}
+					r->rewind_back(n, n->nbytes_);
+					count++;
+					n = nxt;
+				}
+				if (batch) {
+					batch->release(count);
+				}
+			}
+
+			carved_region_t* head_{ nullptr };
+			carved_region_t* dedicated_{ nullptr };
+			std::size_t nregions_{ 0 };
+			thread_cache_t* next_{ nullptr };//arena wide list of caches
+			//kept on its own cache line so remote frees do not bounce the owner's bump state
+			alignas(64) std::atomic<remote_free_t*> remote_frees_{ nullptr };
+		};
+
+		struct thread_cache_state_t {
+			thread_cache_state_t(std::size_t region_cap, std::size_t backing_cap)
+				:backing_(backing_cap), region_cap_(round_to_pow2(region_cap)), id_(next_id()) {}
+
+			thread_cache_state_t(thread_cache_state_t const&) = delete;
+			thread_cache_state_t& operator=(thread_cache_state_t const&) = delete;
+
+			~thread_cache_state_t() {
+				//region headers live inside backing_ memory so only the cache nodes need deleting
+				for (thread_cache_t* list : { caches_, free_caches_ }) {
+					for (auto* c = list; c != nullptr;) {
+						auto* nxt = c->next_;
+						delete c;
+						c = nxt;
+					}
+				}
+			}
+
+			//parked caches are handed out first so their abandoned regions get a new owner
+			[[nodiscard]]
+			thread_cache_t* acquire_cache()noexcept {
+				std::scoped_lock<std::mutex> lock(mutex_);
+				thread_cache_t* c = free_caches_;
+				if (c != nullptr) {
+					free_caches_ = c->next_;
+				}
+				else if ((c = new(std::nothrow) thread_cache_t()) == nullptr) {
+					return nullptr;
+				}
+				c->next_ = caches_;
+				caches_ = c;
+				return c;
+			}
+
+			//thread exit, empty regions go back to the pool while regions that still have
+			//live blocks stay with the parked cache until another thread adopts it
+			void release_cache(thread_cache_t* cache)noexcept {
+				cache->drain_remote_frees(region_cap_);
+				std::scoped_lock<std::mutex> lock(mutex_);
+				return_regions_locked(cache, false);
+				thread_cache_t* prev = nullptr;
+				for (auto* c = caches_; c != nullptr; prev = c, c = c->next_) {
+					if (c == cache) {
+						(prev ? prev->next_ : caches_) = c->next_;
+						break;
+					}
+				}
+				cache->next_ = free_caches_;
+				free_caches_ = cache;
+			}
+
+			void return_regions(thread_cache_t* cache)noexcept {
+				cache->drain_remote_frees(region_cap_);
+				std::scoped_lock<std::mutex> lock(mutex_);
+				return_regions_locked(cache, true);
+			}
+
+			[[nodiscard]]
+			carved_region_t* take_region(std::size_t need, bool dedicated)noexcept {
+				{
+					std::scoped_lock<std::mutex> lock(mutex_);
+					carved_region_t*& list = dedicated ? dedicated_pool_ : pool_;
+					carved_region_t* prev = nullptr;
+					for (auto* r = list; r != nullptr; prev = r, r = r->next_) {
+						if (r->capacity() >= need) {
+							(prev ? prev->next_ : list) = r->next_;
+							r->next_ = nullptr;
+							return r;
+						}
+					}
+				}
+				std::size_t const block = dedicated
+					? (need + carved_region_t::header_size() + region_cap_ - 1) & ~(region_cap_ - 1)
+					: region_cap_;
+				void* mem = backing_.AllocateNoThrow(block, region_cap_);
+				if (mem == nullptr) {
+					return nullptr;
+				}
+				return carved_region_t::create(mem, block, dedicated);
+			}
+
+			void free_all()noexcept {//callers guarantee no thread is using the arena
+				std::scoped_lock<std::mutex> lock(mutex_);
+				for (thread_cache_t* list : { caches_, free_caches_ }) {
+					for (auto* c = list; c != nullptr; c = c->next_) {
+						c->head_ = nullptr;
+						c->dedicated_ = nullptr;
+						c->nregions_ = 0;
+						c->remote_frees_.store(nullptr, std::memory_order_relaxed);
+					}
+				}
+				pool_ = nullptr;
+				dedicated_pool_ = nullptr;
+				backing_.FreeArena();
+			}
+
+			ThreadSafeArena backing_;
+			std::size_t region_cap_;
+			uint64_t id_;
+
+		private:
+			static uint64_t next_id()noexcept {
+				static std::atomic<uint64_t> id{ 0 };
+				return ++id;
+			}
+
+			static std::size_t round_to_pow2(std::size_t n)noexcept {
+				std::size_t p = 1;
+				while (p < n || p < 2 * carved_region_t::header_size()) {
+					p <<= 1;
+				}
+				return p;
+			}
+
+			void return_regions_locked(thread_cache_t* cache, bool clear)noexcept {
+				for (carved_region_t** list : { &cache->head_, &cache->dedicated_ }) {
+					carved_region_t* keep = nullptr;
+					for (auto* r = *list; r != nullptr;) {
+						auto* nxt = r->next_;
+						if (!clear && r->nallocations() != 0) {
+							r->next_ = keep;
+							keep = r;
+						}
+						else {
+							carved_region_t*& pool = r->is_dedicated() ? dedicated_pool_ : pool_;
+							r->clear();
+							r->owner_.store(nullptr, std::memory_order_release);
+							r->next_ = pool;
+							pool = r;
+							cache->nregions_--;
+						}
+						r = nxt;
+					}
+					*list = keep;
+				}
+			}
+
+			std::mutex mutex_;
+			carved_region_t* pool_{ nullptr };//regions handed back by cleared or exited threads
+			carved_region_t* dedicated_pool_{ nullptr };
+			thread_cache_t* caches_{ nullptr };
+			thread_cache_t* free_caches_{ nullptr };
+		};
+
+		//per thread bookkeeping, hands every cache back to its arena when the thread exits
+		struct thread_cache_registry_t {
+			struct entry_t {
+				uint64_t id;
+				std::weak_ptr<thread_cache_state_t> state;
+				thread_cache_t* cache;
+			};
+
+			~thread_cache_registry_t() {
+				for (auto& e : entries_) {
+					if (auto st = e.state.lock()) {
+						st->release_cache(e.cache);
+					}
+				}
+			}
+
+			std::vector<entry_t> entries_;
+		};
+
+		//trivially constructible so the hot path does not go through a tls init guard
+		struct thread_cache_hint_t {
+			uint64_t id;
+			thread_cache_t* cache;
+		};
+		inline thread_local thread_cache_hint_t tls_cache_hint{ 0, nullptr };
+
+		inline thread_cache_registry_t& thread_cache_registry() {
+			thread_local thread_cache_registry_t reg;
+			return reg;
+		}
+	}//end detail
+
+	//every thread bumps its own regions carved out of a shared ThreadSafeArena,
+	//the hot path takes no lock and touches no shared cache lines.
+	//a thread's regions go back to the shared pool when it calls ClearArena, on exit only its empty ones do.
+	//Deallocate of a block owned by another thread is queued on the owner and applied on its next allocation.
+	//the queue entry is written into the freed block itself, so a remote Deallocate must not race with the owner's
+	//ClearArena: once the region is pooled and taken by another thread the write lands in that thread's blocks.
+	//a late free is only dropped safely while the region still sits in the pool. racing the owner's exit is fine,
+	//a region with a live block stays with the parked cache.
+	//region_cap is rounded up to a power of two, blocks aligned to region_cap or more go straight to the backing arena
+	class ThreadCachedArena {
+	public:
+		ThreadCachedArena(std::size_t region_cap = (1 << 16), std::size_t backing_min_cap = (1 << 20))
+			:state_(std::make_shared<detail::thread_cache_state_t>(region_cap, backing_min_cap)) {}
+
+		ThreadCachedArena(ThreadCachedArena const&) = delete;
+		ThreadCachedArena& operator=(ThreadCachedArena const&) = delete;
+
+		[[nodiscard]]
+		void* Allocate(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			void* mem = alloc_nothrow(nbytes, align);
+			if (mem == nullptr) {
+				throw std::bad_alloc();
+			}
+			return mem;
+		}
+		[[nodiscard]]
+		void* AllocateNoThrow(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			return alloc_nothrow(nbytes, align);
+		}
+		[[nodiscard]]
+		void* Reallocate(void* mem,
+			std::size_t old_size,
+			std::size_t new_size,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			void* remem = realloc_nothrow(mem, old_size, new_size, align);
+			if (remem == nullptr) {
+				throw std::bad_alloc();
+			}
+			return remem;
+		}
+		[[nodiscard]]
+		void* ReallocateNoThrow(void* mem,
+			std::size_t old_size,
+			std::size_t new_size,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			return realloc_nothrow(mem, old_size, new_size, align);
+		}
+
+		void Deallocate(void* mem,
+			std::size_t nbytes,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			(void)align;
+			if (mem == nullptr) {
+				return;
+			}
+			nbytes = block_size_for(nbytes);
+			if (is_direct(mem)) {
+				return state_->backing_.Deallocate(mem, nbytes);
+			}
+			auto* region = region_of(mem);
+			detail::thread_cache_t* owner = region->owner_.load(std::memory_order_acquire);
+			if (owner == nullptr) {//the region went back to the pool with ClearArena, so did the block. see the class comment
+				return;
+			}
+			if (owner == existing_cache()) {
+				return region->free_reservation(mem, nbytes);
+			}
+			owner->push_remote(mem, nbytes);
+		}
+
+		//hands the calling thread's regions back to the shared pool
+		void ClearArena()noexcept {
+			if (detail::thread_cache_t* cache = existing_cache()) {
+				state_->return_regions(cache);
+			}
+		}
+
+		//frees every region of every thread, must not race with any other call on this arena
+		void FreeArena()noexcept {
+			state_->free_all();
+		}
+
+		std::size_t NumLocalRegions()noexcept {
+			detail::thread_cache_t* cache = existing_cache();
+			return cache ? cache->nregions_ : 0;
+		}
+
+		ThreadSafeArena& Backing()noexcept {
+			return state_->backing_;
+		}
+
+	private:
+		//every block must be able to hold a remote_free_t once it is freed remotely
+		static constexpr std::size_t block_size_for(std::size_t nbytes)noexcept {
+			return nbytes < sizeof(detail::remote_free_t) ? sizeof(detail::remote_free_t) : nbytes;
+		}
+		static constexpr std::size_t block_align_for(std::size_t align)noexcept {
+			return align < alignof(detail::remote_free_t) ? alignof(detail::remote_free_t) : align;
+		}
+
+		//carved blocks never start on a region boundary so only direct backing allocations do
+		[[nodiscard]]
+		bool is_direct(void const* mem)const noexcept {
+			return (reinterpret_cast<uintptr_t>(mem) & (state_->region_cap_ - 1)) == 0;
+		}
+
+		[[nodiscard]]
+		detail::carved_region_t* region_of(void const* mem)const noexcept {
+			return detail::carved_region_t::from_pointer(mem, state_->region_cap_);
+		}
+
+		//the calling thread's cache, acquired on its first allocation
+		[[nodiscard]]
+		detail::thread_cache_t* local_cache()noexcept {
+			auto& hint = detail::tls_cache_hint;
+			if (hint.id == state_->id_) {
+				return hint.cache;
+			}
+			return local_cache_slow(true);
+		}
+		//the calling thread's cache or null, for calls that have no reason to make a thread own one
+		[[nodiscard]]
+		detail::thread_cache_t* existing_cache()noexcept {
+			auto& hint = detail::tls_cache_hint;
+			if (hint.id == state_->id_) {
+				return hint.cache;
+			}
+			return local_cache_slow(false);
+		}
+
+		[[nodiscard]]
+		detail::thread_cache_t* local_cache_slow(bool acquire)noexcept {
+			auto& reg = detail::thread_cache_registry();
+			detail::thread_cache_t* cache = nullptr;
+			for (auto const& e : reg.entries_) {
+				if (e.id == state_->id_) {
+					cache = e.cache;
+					break;
+				}
+			}
+			if (cache == nullptr) {
+				if (!acquire) {
+					return nullptr;
+				}
+				cache = state_->acquire_cache();
+				if (cache == nullptr) {
+					return nullptr;
+				}
+				try {
+					reg.entries_.push_back({ state_->id_, state_, cache });
+				}
+				catch (...) {
+					state_->release_cache(cache);
+					return nullptr;
+				}
+			}
+			detail::tls_cache_hint = { state_->id_, cache };
+			return cache;
+		}
+
+		[[nodiscard]]
+		void* alloc_nothrow(std::size_t nbytes, std::size_t align)noexcept {
+			detail::thread_cache_t* cache = local_cache();
+			if (cache == nullptr) {
+				return nullptr;
+			}
+			if (cache->has_remote_frees()) {
+				cache->drain_remote_frees(state_->region_cap_);
+			}
+			nbytes = block_size_for(nbytes);
+			align = block_align_for(align);
+			if (cache->head_ != nullptr) {
+				if (void* mem = cache->head_->try_reserve(nbytes, align)) {
+					return mem;
+				}
+			}
+			return alloc_slow(cache, nbytes, align);
+		}
+
+		[[nodiscard]]
+		void* alloc_slow(detail::thread_cache_t* cache, std::size_t nbytes, std::size_t align)noexcept {
+			std::size_t const region_cap = state_->region_cap_;
+			if (align >= region_cap) {//the block would start on a region boundary, see is_direct
+				return state_->backing_.AllocateNoThrow(nbytes, std::max(align, region_cap));
+			}
+			std::size_t const need = nbytes + (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? align : 0);
+			bool const dedicated = need > region_cap - detail::carved_region_t::header_size();
+			detail::carved_region_t* r = dedicated ? cache->empty_dedicated(need) : nullptr;
+			if (r == nullptr) {
+				r = state_->take_region(need, dedicated);
+				if (r == nullptr) {
+					return nullptr;
+				}
+				cache->push_region(r);
+			}
+			return r->try_reserve(nbytes, align);
+		}
+
+		[[nodiscard]]
+		void* realloc_nothrow(void* mem, std::size_t olds, std::size_t news, std::size_t align)noexcept {
+			if (mem == nullptr) {
+				return alloc_nothrow(news, align);
+			}
+			if (news == olds) {
+				return mem;
+			}
+			if (0 == news) {
+				Deallocate(mem, olds, align);
+				return nullptr;
+			}
+			olds = block_size_for(olds);
+			news = block_size_for(news);
+			if (is_direct(mem)) {
+				return state_->backing_.ReallocateNoThrow(mem, olds, news,
+					std::max(block_align_for(align), state_->region_cap_));
+			}
+			auto* region = region_of(mem);
+			if (region->owner_.load(std::memory_order_acquire) == local_cache() && region->try_resize_back(mem, olds, news)) {
+				return mem;
+			}
+			if (news < olds) {
+				return mem;
+			}
+			void* newreg = alloc_nothrow(news, align);
+			if (!newreg) {
+				return nullptr;
+			}
+			std::memcpy(newreg, mem, olds);
+			Deallocate(mem, olds, align);
+			return newreg;
+		}
+
+		std::shared_ptr<detail::thread_cache_state_t> state_;
+	};
+
+}//end megu
@@ -0,0 +1,243 @@
+#pragma once
+#include "arena.hpp"
+
+#ifndef MEGU_USE_CONSTEXPR_ALLOC
+namespace megu {
+	//arena over a single contiguous reservation of address space, pages are committed as the bump pointer reaches them.
+	//nothing ever moves so the back allocation grows in place and ownership is a bounds check,
+	//running past the reservation fails the allocation, there is no second region to fall back to
+	class VirtualArena {
+	public:
+		VirtualArena(std::size_t reserve_bytes = (std::size_t(1) << 32),
+			std::size_t commit_step = (1 << 16))noexcept
+			:base_(nullptr), reserved_(0), committed_(0), size_(0), allocs_(0),
+			commit_step_(round_to_page(commit_step == 0 ? 1 : commit_step))
+		{
+			reserve_bytes = round_to_page(reserve_bytes);
+			base_ = static_cast<char*>(detail::SysReserve(reserve_bytes, std::nothrow));
+			if (base_ != nullptr) {
+				reserved_ = reserve_bytes;
+			}
+		}
+
+		VirtualArena(VirtualArena const&) = delete;
+		VirtualArena& operator=(VirtualArena const&) = delete;
+
+		VirtualArena(VirtualArena&& other)noexcept {
+			private_move(std::move(other));
+		}
+		VirtualArena& operator=(VirtualArena&& other)noexcept {
+			if (this != &other) {
+				release_reservation();
+				private_move(std::move(other));
+			}
+			return *this;
+		}
+
+		~VirtualArena() {
+			release_reservation();
+		}
+
+		[[nodiscard]]
+		void* Allocate(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			void* mem = alloc_nothrow(nbytes, align);
+			if (mem == nullptr) {
+				throw std::bad_alloc();
+			}
+			return mem;
+		}
+		[[nodiscard]]
+		void* AllocateNoThrow(std::size_t nbytes, std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			return alloc_nothrow(nbytes, align);
+		}
+
+		[[nodiscard]]
+		void* Reallocate(void* mem,
+			std::size_t old_size,
+			std::size_t new_size,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			void* remem = realloc_nothrow(mem, old_size, new_size, align);
+			if (remem == nullptr) {
+				throw std::bad_alloc();
+			}
+			return remem;
+		}
+		[[nodiscard]]
+		void* ReallocateNoThrow(void* mem,
+			std::size_t old_size,
+			std::size_t new_size,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			return realloc_nothrow(mem, old_size, new_size, align);
+		}
+
+		void Deallocate(void* mem,
+			std::size_t nbytes,
+			std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)noexcept {
+			(void)align;
+			if (!Owns(mem)) {
+				return;
+			}
+			if (--allocs_ == 0) {
+				size_ = 0;
+				return;
+			}
+			if (is_back(mem, nbytes)) {
+				size_ -= nbytes;
+			}
+		}
+
+		[[nodiscard]]
+		bool Owns(void const* mem)const noexcept {
+			return mem >= base_ && mem < base_ + size_;
+		}
+
+		//forgets every allocation, committed pages are kept for reuse
+		void ClearArena()noexcept {
+			size_ = 0;
+			allocs_ = 0;
+		}
+		//forgets every allocation and gives the committed pages back, the reservation is kept
+		void FreeArena()noexcept {
+			ClearArena();
+			DecommitUnused();
+		}
+		//gives back the committed pages above the bump pointer
+		void DecommitUnused()noexcept {
+			std::size_t const keep = round_to_step(size_);
+			if (keep < committed_) {
+				detail::SysDecommit(base_ + keep, committed_ - keep);
+				committed_ = keep;
+			}
+		}
+
+		[[nodiscard]]
+		bool IsValid()const noexcept {
+			return base_ != nullptr;
+		}
+		[[nodiscard]]
+		std::size_t Size()const noexcept {
+			return size_;
+		}
+		[[nodiscard]]
+		std::size_t Committed()const noexcept {
+			return committed_;
+		}
+		[[nodiscard]]
+		std::size_t Reserved()const noexcept {
+			return reserved_;
+		}
+		[[nodiscard]]
+		std::size_t NumAllocations()const noexcept {
+			return allocs_;
+		}
+
+		std::string DumpUsage() {
+			std::ostringstream ss;
+			ss << "Dumping usage for virtual arena : " << this << " {\n"
+				<< "  <total_allocs : " << allocs_ << ", reserved : " << size_
+				<< ", committed : " << committed_ << ", address-space : " << reserved_
+				<< ", data-address : " << static_cast<void*>(base_) << ">\n}\n";
+			return ss.str();
+		}
+
+	private:
+		[[nodiscard]]
+		void* alloc_nothrow(std::size_t nbytes, std::size_t align)noexcept {
+			if (base_ == nullptr) {
+				return nullptr;
+			}
+			std::size_t const aligned = detail::alignment_offset(align, base_ + size_);
+			if (nbytes > reserved_ - size_ || aligned > reserved_ - size_ - nbytes) {
+				return nullptr;
+			}
+			std::size_t const nsize = size_ + aligned + nbytes;
+			if (!ensure_committed(nsize)) {
+				return nullptr;
+			}
+			void* mem = base_ + size_ + aligned;
+			size_ = nsize;
+			++allocs_;
+			return mem;
+		}
+
+		[[nodiscard]]
+		void* realloc_nothrow(void* mem, std::size_t olds, std::size_t news, std::size_t align)noexcept {
+			if (mem == nullptr) {
+				return alloc_nothrow(news, align);
+			}
+			if (is_back(mem, olds) && detail::alignment_offset(align, mem) == 0) {
+				std::size_t const off = static_cast<std::size_t>(static_cast<char*>(mem) - base_);
+				if (news > reserved_ - off || !ensure_committed(off + news)) {
+					return nullptr;
+				}
+				size_ = off + news;
+				return mem;
+			}
+			void* remem = alloc_nothrow(news, align);
+			if (remem == nullptr) {
+				return nullptr;
+			}
+			std::memcpy(remem, mem, std::min(olds, news));
+			Deallocate(mem, olds, align);
+			return remem;
+		}
+
+		[[nodiscard]]
+		bool is_back(void const* mem, std::size_t nbytes)const noexcept {
+			return static_cast<char const*>(mem) + nbytes == base_ + size_;
+		}
+
+		[[nodiscard]]
+		bool ensure_committed(std::size_t end)noexcept {
+			if (end <= committed_) {
+				return true;
+			}
+			std::size_t const target = std::min(round_to_step(end), reserved_);
+			if (!detail::SysCommit(base_ + committed_, target - committed_, std::nothrow)) {
+				return false;
+			}
+			committed_ = target;
+			return true;
+		}
+
+		[[nodiscard]]
+		std::size_t round_to_step(std::size_t n)const noexcept {
+			return (n + commit_step_ - 1) / commit_step_ * commit_step_;
+		}
+		[[nodiscard]]
+		static std::size_t round_to_page(std::size_t n)noexcept {
+			std::size_t const pg = static_cast<std::size_t>(GetPageSize());
+			return (n + pg - 1) / pg * pg;
+		}
+
+		void release_reservation()noexcept {
+			if (base_ != nullptr) {
+				detail::SysFree(base_, reserved_);
+				base_ = nullptr;
+			}
+		}
+
+		void private_move(VirtualArena&& other)noexcept {
+			base_ = other.base_;
+			other.base_ = nullptr;
+			reserved_ = other.reserved_;
+			other.reserved_ = 0;
+			committed_ = other.committed_;
+			other.committed_ = 0;
+			size_ = other.size_;
+			other.size_ = 0;
+			allocs_ = other.allocs_;
+			other.allocs_ = 0;
+			commit_step_ = other.commit_step_;
+		}
+
+		char* base_;
+		std::size_t reserved_;
+		std::size_t committed_;//[base_, base_ + committed_) is readable and writable
+		std::size_t size_;
+		std::size_t allocs_;
+		std::size_t commit_step_;
+	};
+
+}//end megu
+#endif //MEGU_USE_CONSTEXPR_ALLOC
@@ -0,0 +1,144 @@
+//push heavy workloads on ArenaVector/ArenaString against std::vector/std::string:
+//many short lived vectors built one after the other, vectors that all stay alive, two vectors growing side by side
+//and one string built from small appends. the best of five runs is reported.
+//build from the repository root:
+//  g++ -std=c++20 -O2 -DNDEBUG -DMEGU_USE_CPPNEW=false -DMEGU_USE_LOGGING=false -I. bench/arena_containers.cpp -o bench_containers
+//usage: bench_containers
+#include "arena/arena_containers.hpp"
+#include "arena/virtual_arena.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+	constexpr std::size_t region_size = (1 << 20);
+	constexpr int runs = 5;
+	constexpr int nvectors = 2000;
+	constexpr int vector_len = 5000;
+	constexpr int pair_len = 5000000;
+	constexpr int nappends = 4000000;
+
+	volatile std::size_t sink;
+
+	//milliseconds, best of runs
+	template<typename F>
+	double best_of(F f) {
+		double best = 0;
+		for (int r = 0; r < runs; ++r) {
+			auto const t0 = std::chrono::steady_clock::now();
+			f();
+			double const ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+			best = r == 0 ? ms : std::min(best, ms);
+		}
+		return best;
+	}
+
+	void row(char const* name, double ms) {
+		std::printf("  %-26s %9.2f ms\n", name, ms);
+	}
+}
+
+int main() {
+	std::printf("%d vectors of %d ints built one after the other, each dropped before the next:\n", nvectors, vector_len);
+	row("std::vector", best_of([] {
+		for (int v = 0; v < nvectors; ++v) {
+			std::vector<int> vec;
+			for (int i = 0; i < vector_len; ++i) {
+				vec.push_back(i);
+			}
+			sink = vec.size();
+		}
+	}));
+	row("ArenaVector", best_of([] {
+		megu::Arena arena(region_size);
+		for (int v = 0; v < nvectors; ++v) {
+			megu::ArenaVector<int> vec(arena);
+			for (int i = 0; i < vector_len; ++i) {
+				vec.push_back(i);
+			}
+			sink = vec.size();
+		}
+	}));
+
+	std::printf("%d vectors of %d ints built one after the other, all kept alive:\n", nvectors, vector_len);
+	row("std::vector", best_of([] {
+		std::vector<std::vector<int>> all(nvectors);
+		for (auto& vec : all) {
+			for (int i = 0; i < vector_len; ++i) {
+				vec.push_back(i);
+			}
+		}
+		sink = all.size();
+	}));
+	row("ArenaVector", best_of([] {
+		megu::Arena arena(region_size);
+		std::vector<megu::ArenaVector<int>> all;
+		all.reserve(nvectors);
+		for (int v = 0; v < nvectors; ++v) {
+			auto& vec = all.emplace_back(arena);
+			for (int i = 0; i < vector_len; ++i) {
+				vec.push_back(i);
+			}
+		}
+		sink = all.size();
+	}));
+	row("ArenaVector, VirtualArena", best_of([] {
+		megu::VirtualArena arena;
+		std::vector<megu::ArenaVector<int, megu::VirtualArena>> all;
+		all.reserve(nvectors);
+		for (int v = 0; v < nvectors; ++v) {
+			auto& vec = all.emplace_back(arena);
+			for (int i = 0; i < vector_len; ++i) {
+				vec.push_back(i);
+			}
+		}
+		sink = all.size();
+	}));
+
+	std::printf("2 vectors growing side by side to %d ints each:\n", pair_len);
+	row("std::vector", best_of([] {
+		std::vector<int> x, y;
+		for (int i = 0; i < pair_len; ++i) {
+			x.push_back(i);
+			y.push_back(i);
+		}
+		sink = x.size() + y.size();
+	}));
+	row("ArenaVector", best_of([] {
+		megu::Arena arena(region_size);
+		megu::ArenaVector<int> x(arena), y(arena);
+		for (int i = 0; i < pair_len; ++i) {
+			x.push_back(i);
+			y.push_back(i);
+		}
+		sink = x.size() + y.size();
+	}));
+
+	std::printf("1 string built from %d appends of 7 chars:\n", nappends);
+	row("std::string", best_of([] {
+		std::string str;
+		for (int i = 0; i < nappends; ++i) {
+			str += "abcdefg";
+		}
+		sink = str.size();
+	}));
+	row("ArenaString", best_of([] {
+		megu::Arena arena(region_size);
+		megu::ArenaString str(arena);
+		for (int i = 0; i < nappends; ++i) {
+			str += "abcdefg";
+		}
+		sink = str.size();
+	}));
+	row("ArenaString, VirtualArena", best_of([] {
+		megu::VirtualArena arena;
+		megu::BasicArenaString<char, megu::VirtualArena> str(arena);
+		for (int i = 0; i < nappends; ++i) {
+			str += "abcdefg";
+		}
+		sink = str.size();
+	}));
+	return 0;
+}
@@ -0,0 +1,83 @@
+//ArenaResource against the std::pmr resources on a request shaped workload: every request fills a pmr vector,
+//an unordered_map and a handful of strings, then the whole request is thrown away at once. the arena is cleared,
+//monotonic_buffer_resource and unsynchronized_pool_resource are released and new_delete_resource frees one by one.
+//the best of three runs is reported.
+//build from the repository root:
+//  g++ -std=c++20 -O2 -DNDEBUG -DMEGU_USE_CPPNEW=false -DMEGU_USE_LOGGING=false -I. bench/arena_resource.cpp -o bench_resource
+//usage: bench_resource [requests = 5000]
+#include "arena/arena_allocator.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+	constexpr std::size_t region_size = (1 << 16);
+	constexpr int runs = 3;
+
+	//returns something derived from the request so the work cannot be dropped
+	std::size_t request(std::pmr::memory_resource* res) {
+		std::pmr::vector<int> vec(res);
+		for (int i = 0; i < 1000; ++i) {
+			vec.push_back(i);
+		}
+		std::pmr::unordered_map<int, int> map(res);
+		for (int i = 0; i < 500; ++i) {
+			map[i * 7] = i;
+		}
+		std::pmr::vector<std::pmr::string> strs(res);
+		for (int i = 0; i < 50; ++i) {
+			strs.emplace_back(40 + i % 16, 'x');
+		}
+		return vec.size() + map.size() + strs.back().size();
+	}
+
+	//milliseconds for all requests, reset runs after every request
+	template<typename Reset>
+	double run_once(std::pmr::memory_resource* res, Reset reset, std::size_t nrequests, std::size_t& sink) {
+		auto const t0 = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < nrequests; ++i) {
+			sink += request(res);
+			reset();
+		}
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+	}
+
+	template<typename Reset>
+	double best_of(std::pmr::memory_resource* res, Reset reset, std::size_t nrequests, std::size_t& sink) {
+		double best = 0;
+		for (int r = 0; r < runs; ++r) {
+			double const ms = run_once(res, reset, nrequests, sink);
+			best = r == 0 ? ms : std::min(best, ms);
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::size_t const nrequests = argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : 5000;
+	std::size_t sink = 0;
+
+	megu::Arena arena(region_size);
+	megu::ArenaResource arena_res(arena);
+	double const t_arena = best_of(&arena_res, [&] { arena.ClearArena(); }, nrequests, sink);
+
+	std::pmr::monotonic_buffer_resource mono;
+	double const t_mono = best_of(&mono, [&] { mono.release(); }, nrequests, sink);
+
+	std::pmr::unsynchronized_pool_resource pool;
+	double const t_pool = best_of(&pool, [&] { pool.release(); }, nrequests, sink);
+
+	double const t_new = best_of(std::pmr::new_delete_resource(), [] {}, nrequests, sink);
+
+	std::printf("%zu requests (checksum %zu)\n", nrequests, sink);
+	std::printf("%-32s %10s\n", "resource", "ms");
+	std::printf("%-32s %10.1f\n", "megu::ArenaResource", t_arena);
+	std::printf("%-32s %10.1f\n", "monotonic_buffer_resource", t_mono);
+	std::printf("%-32s %10.1f\n", "unsynchronized_pool_resource", t_pool);
+	std::printf("%-32s %10.1f\n", "new_delete_resource", t_new);
+	return 0;
+}
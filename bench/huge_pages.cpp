@@ -0,0 +1,128 @@
+//random reads over one multi GB arena block backed by normal pages, transparent huge pages and explicit huge pages.
+//every read depends on the one before it so the time is the miss latency, most of which is the page walk once
+//the block is far bigger than what the TLB covers. first touch of the whole block is timed on its own.
+//explicit huge pages need a hugetlbfs pool (vm.nr_hugepages), without one the row is reported as unavailable
+//instead of silently measuring the transparent fallback. the best of three runs is reported.
+//build from the repository root:
+//  g++ -std=c++20 -O2 -DNDEBUG -DMEGU_USE_CPPNEW=false -DMEGU_USE_LOGGING=false -I. bench/huge_pages.cpp -o bench_huge
+//usage: bench_huge [GiB = 2] [reads = 16777216]
+#include "arena/arena.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+namespace {
+	constexpr int runs = 3;
+
+	struct result_t {
+		double touch_ms;
+		double read_ns;
+		long long huge_mib;//-1 when the system does not say
+	};
+
+	//resident transparent huge pages of the process, linux only
+	long long anon_huge_mib() {
+		std::ifstream in("/proc/self/smaps_rollup");
+		std::string key;
+		long long kb = 0;
+		while (in >> key) {
+			if (key == "AnonHugePages:" && in >> kb) {
+				return kb / 1024;
+			}
+		}
+		return -1;
+	}
+
+	//whether the system can back bytes with explicit huge pages right now
+	bool explicit_available(std::size_t bytes) {
+#ifdef _WIN32
+		void* at = VirtualAlloc(nullptr, bytes, MEM_LARGE_PAGES | MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		if (at == nullptr) {
+			return false;
+		}
+		VirtualFree(at, 0, MEM_RELEASE);
+		return true;
+#elif defined(MAP_HUGETLB)
+		void* at = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+		if (at == MAP_FAILED) {
+			return false;
+		}
+		munmap(at, bytes);
+		return true;
+#else
+		(void)bytes;
+		return false;
+#endif
+	}
+
+	result_t run_once(megu::HugePages_t pages, std::size_t bytes, std::size_t reads, std::uint64_t& sink) {
+		megu::Arena arena(bytes);
+		arena.SetHugePages(pages);
+		std::size_t const n = bytes / sizeof(std::uint64_t);
+		auto* buf = static_cast<std::uint64_t*>(arena.Allocate(bytes));
+
+		auto const t0 = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < n; ++i) {
+			buf[i] = i * 0x9e3779b97f4a7c15ull;
+		}
+		auto const t1 = std::chrono::steady_clock::now();
+		//n is a power of two, the xorshift keeps the walk from settling into a short cycle
+		std::uint64_t x = 88172645463325252ull, at = 0;
+		for (std::size_t r = 0; r < reads; ++r) {
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+			at = (buf[at] ^ x) & (n - 1);
+		}
+		auto const t2 = std::chrono::steady_clock::now();
+		sink += at;
+		long long const huge = anon_huge_mib();
+		arena.Deallocate(buf, bytes);
+		return { std::chrono::duration<double, std::milli>(t1 - t0).count(),
+			std::chrono::duration<double, std::nano>(t2 - t1).count() / static_cast<double>(reads), huge };
+	}
+
+	result_t best_of(megu::HugePages_t pages, std::size_t bytes, std::size_t reads, std::uint64_t& sink) {
+		result_t best = run_once(pages, bytes, reads, sink);
+		for (int r = 1; r < runs; ++r) {
+			result_t const res = run_once(pages, bytes, reads, sink);
+			best.touch_ms = std::min(best.touch_ms, res.touch_ms);
+			best.read_ns = std::min(best.read_ns, res.read_ns);
+		}
+		return best;
+	}
+
+	void row(char const* name, result_t const& res) {
+		if (res.huge_mib < 0) {
+			std::printf("%-12s %12.1f %12.1f %12s\n", name, res.touch_ms, res.read_ns, "-");
+		}
+		else {
+			std::printf("%-12s %12.1f %12.1f %12lld\n", name, res.touch_ms, res.read_ns, res.huge_mib);
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	std::size_t const gib = argc > 1 ? std::max<std::size_t>(1, std::strtoull(argv[1], nullptr, 10)) : 2;
+	std::size_t const reads = argc > 2 ? static_cast<std::size_t>(std::strtoull(argv[2], nullptr, 10)) : (1 << 24);
+	std::size_t const bytes = gib << 30;
+	std::uint64_t sink = 0;
+
+	std::printf("%zu GiB block, %zu dependent random reads, huge page size %lld KiB\n",
+		gib, reads, static_cast<long long>(megu::GetHugePageSize() >> 10));
+	std::printf("%-12s %12s %12s %12s\n", "pages", "touch ms", "read ns", "THP MiB");
+	row("NONE", best_of(megu::HugePages_t::NONE, bytes, reads, sink));
+	row("TRANSPARENT", best_of(megu::HugePages_t::TRANSPARENT, bytes, reads, sink));
+	if (explicit_available(bytes)) {
+		row("EXPLICIT", best_of(megu::HugePages_t::EXPLICIT, bytes, reads, sink));
+	}
+	else {
+		std::printf("%-12s %12s\n", "EXPLICIT", "unavailable, no hugetlbfs pages for the block");
+	}
+	std::printf("checksum %llu\n", static_cast<unsigned long long>(sink));
+	return 0;
+}
@@ -0,0 +1,86 @@
+//cost of Deallocate/Reallocate as the number of regions grows, both have to find the region of the block first.
+//each 4KiB region holds three 1000 byte blocks, the blocks are visited in random order so the lookups are cold.
+//Reallocate shrinks every block by a little, which past the first round is the lookup and nothing else.
+//the best of three runs is reported, the cost should stay flat across region counts.
+//build from the repository root:
+//  g++ -std=c++20 -O2 -DNDEBUG -DMEGU_USE_CPPNEW=false -DMEGU_USE_LOGGING=false -I. bench/page_map.cpp -o bench_page_map
+//usage: bench_page_map [region counts = 10 1000 10000]
+#include "arena/arena.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+	constexpr std::size_t region_size = (1 << 12);
+	constexpr std::size_t block_size = 1000;
+	constexpr std::size_t blocks_per_region = 3;
+	constexpr int runs = 3;
+	constexpr std::size_t min_ops = 1000000;
+
+	struct result_t {
+		double dealloc_ns;
+		double realloc_ns;
+		std::size_t regions;
+	};
+
+	result_t run_once(std::size_t nregions) {
+		megu::Arena arena(region_size);
+		std::vector<void*> blocks;
+		blocks.reserve(nregions * blocks_per_region);
+		while (arena.NumRegions() < nregions || blocks.size() % blocks_per_region != 0) {
+			blocks.push_back(arena.Allocate(block_size));
+		}
+		std::size_t const regions = arena.NumRegions();
+		std::mt19937 rng(7);
+		std::shuffle(blocks.begin(), blocks.end(), rng);
+
+		std::size_t const rounds = std::max<std::size_t>(1, min_ops / blocks.size());
+		auto const t0 = std::chrono::steady_clock::now();
+		for (std::size_t r = 0; r < rounds; ++r) {
+			for (void* mem : blocks) {
+				void* same = arena.Reallocate(mem, block_size, block_size - 16);
+				if (same != mem) {
+					std::abort();
+				}
+			}
+		}
+		auto const t1 = std::chrono::steady_clock::now();
+		for (void* mem : blocks) {
+			arena.Deallocate(mem, block_size);
+		}
+		auto const t2 = std::chrono::steady_clock::now();
+		double const nre = static_cast<double>(rounds * blocks.size());
+		double const nde = static_cast<double>(blocks.size());
+		return { std::chrono::duration<double, std::nano>(t2 - t1).count() / nde,
+			std::chrono::duration<double, std::nano>(t1 - t0).count() / nre, regions };
+	}
+
+	result_t best_of(std::size_t nregions) {
+		result_t best = run_once(nregions);
+		for (int r = 1; r < runs; ++r) {
+			result_t const res = run_once(nregions);
+			best.dealloc_ns = std::min(best.dealloc_ns, res.dealloc_ns);
+			best.realloc_ns = std::min(best.realloc_ns, res.realloc_ns);
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::vector<std::size_t> counts;
+	for (int i = 1; i < argc; ++i) {
+		counts.push_back(static_cast<std::size_t>(std::strtoull(argv[i], nullptr, 10)));
+	}
+	if (counts.empty()) {
+		counts = { 10, 1000, 10000 };
+	}
+	std::printf("%10s %16s %16s\n", "regions", "Deallocate ns", "Reallocate ns");
+	for (std::size_t n : counts) {
+		result_t const res = best_of(n);
+		std::printf("%10zu %16.1f %16.1f\n", res.regions, res.dealloc_ns, res.realloc_ns);
+	}
+	return 0;
+}
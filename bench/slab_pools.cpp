@@ -0,0 +1,98 @@
+//churn of small blocks through an Arena with slab pools, the plain bump Arena and malloc. a working set of
+//live blocks of 16 to 256 bytes is kept, every operation frees a random one and allocates a replacement of a
+//random size. without slab pools the arena can only reuse the freed tail so it keeps growing, the region
+//count after the run shows how far. the best of three runs is reported.
+//build from the repository root:
+//  g++ -std=c++20 -O2 -DNDEBUG -DMEGU_USE_CPPNEW=false -DMEGU_USE_LOGGING=false -I. bench/slab_pools.cpp -o bench_slab
+//usage: bench_slab [operations = 10000000] [live blocks = 10000]
+#include "arena/arena.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+	constexpr std::size_t region_size = (1 << 16);
+	constexpr std::size_t min_block = 16;
+	constexpr std::size_t max_block = 256;
+	constexpr int runs = 3;
+
+	enum class backend_t { bump, slab, malloc };
+
+	struct result_t {
+		double ns_per_op;
+		std::size_t regions;
+	};
+
+	result_t run_once(backend_t backend, std::size_t ops, std::size_t nlive) {
+		megu::Arena arena(region_size);
+		arena.SetSlabPools(backend == backend_t::slab);
+		auto alloc = [&](std::size_t nbytes) {
+			return backend == backend_t::malloc ? std::malloc(nbytes) : arena.Allocate(nbytes);
+		};
+		auto dealloc = [&](void* mem, std::size_t nbytes) {
+			if (backend == backend_t::malloc) {
+				std::free(mem);
+			}
+			else {
+				arena.Deallocate(mem, nbytes);
+			}
+		};
+
+		std::mt19937 rng(9);
+		std::uniform_int_distribution<std::size_t> size_dist(min_block, max_block);
+		std::uniform_int_distribution<std::size_t> slot_dist(0, nlive - 1);
+		std::vector<std::pair<void*, std::size_t>> live(nlive);
+		for (auto& [mem, nbytes] : live) {
+			nbytes = size_dist(rng);
+			mem = alloc(nbytes);
+		}
+		auto const t0 = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < ops; ++i) {
+			auto& [mem, nbytes] = live[slot_dist(rng)];
+			dealloc(mem, nbytes);
+			nbytes = size_dist(rng);
+			mem = alloc(nbytes);
+			*static_cast<char*>(mem) = 1;
+		}
+		double const ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+		std::size_t const regions = backend == backend_t::malloc ? 0 : arena.NumRegions();
+		for (auto& [mem, nbytes] : live) {
+			dealloc(mem, nbytes);
+		}
+		return { ns / static_cast<double>(ops), regions };
+	}
+
+	result_t best_of(backend_t backend, std::size_t ops, std::size_t nlive) {
+		result_t best = run_once(backend, ops, nlive);
+		for (int r = 1; r < runs; ++r) {
+			result_t const res = run_once(backend, ops, nlive);
+			if (res.ns_per_op < best.ns_per_op) {
+				best = res;
+			}
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::size_t const ops = argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : 10000000;
+	std::size_t const nlive = argc > 2 ? std::max<std::size_t>(1, std::strtoull(argv[2], nullptr, 10)) : 10000;
+
+	std::printf("%zu operations over %zu live blocks of %zu to %zu bytes\n", ops, nlive, min_block, max_block);
+	std::printf("%-12s %10s %10s\n", "allocator", "ns/op", "regions");
+	std::pair<char const*, backend_t> const backends[] = {
+		{ "bump arena", backend_t::bump }, { "slab pools", backend_t::slab }, { "malloc", backend_t::malloc } };
+	for (auto const& [name, backend] : backends) {
+		result_t const res = best_of(backend, ops, nlive);
+		if (backend == backend_t::malloc) {
+			std::printf("%-12s %10.1f %10s\n", name, res.ns_per_op, "-");
+		}
+		else {
+			std::printf("%-12s %10.1f %10zu\n", name, res.ns_per_op, res.regions);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,79 @@
+//allocation throughput of the lock-free ThreadSafeArena against an Arena behind a std::mutex, which is what
+//ThreadSafeArena used to be. every thread allocates 32 byte blocks from the shared arena and gives every
+//fourth one back right away, regions are 1MiB. the best of three runs is reported per thread count.
+//the numbers only say something about contention on a machine with at least as many cores as threads.
+//build from the repository root:
+//  g++ -std=c++20 -O2 -DNDEBUG -DMEGU_USE_CPPNEW=false -DMEGU_USE_LOGGING=false -I. bench/thread_safe_arena.cpp -o bench_tsa -lpthread
+//usage: bench_tsa [max threads = hardware threads] [allocations per thread = 1000000]
+#include "arena/arena.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+	using MutexArena = megu::BasicArena<std::mutex>;
+
+	constexpr std::size_t region_size = (1 << 20);
+	constexpr std::size_t block_size = 32;
+	constexpr int runs = 3;
+
+	//millions of allocations per second over all threads, the clock starts once every thread is waiting to go
+	template<typename ArenaT>
+	double run_once(unsigned nthreads, std::size_t ops) {
+		ArenaT arena(region_size);
+		std::atomic<unsigned> ready{ 0 };
+		std::atomic<bool> go{ false };
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < nthreads; ++t) {
+			threads.emplace_back([&] {
+				ready.fetch_add(1);
+				while (!go.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+				for (std::size_t i = 0; i < ops; ++i) {
+					void* mem = arena.Allocate(block_size, 16);
+					if (i % 4 == 0) {
+						arena.Deallocate(mem, block_size, 16);
+					}
+				}
+			});
+		}
+		while (ready.load() != nthreads) {
+			std::this_thread::yield();
+		}
+		auto const t0 = std::chrono::steady_clock::now();
+		go.store(true, std::memory_order_release);
+		for (auto& th : threads) {
+			th.join();
+		}
+		double const secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		return static_cast<double>(nthreads) * static_cast<double>(ops) / secs / 1e6;
+	}
+
+	template<typename ArenaT>
+	double best_of(unsigned nthreads, std::size_t ops) {
+		double best = 0;
+		for (int r = 0; r < runs; ++r) {
+			best = std::max(best, run_once<ArenaT>(nthreads, ops));
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv) {
+	unsigned const hw = std::max(1u, std::thread::hardware_concurrency());
+	unsigned const max_threads = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : hw;
+	std::size_t const ops = argc > 2 ? static_cast<std::size_t>(std::strtoull(argv[2], nullptr, 10)) : 1000000;
+
+	std::printf("hardware threads: %u, %zu allocations of %zu bytes per thread\n", hw, ops, block_size);
+	std::printf("%8s %16s %16s\n", "threads", "mutex Mops/s", "lock-free Mops/s");
+	for (unsigned n = 1; n <= std::max(1u, max_threads); n *= 2) {
+		double const locked = best_of<MutexArena>(n, ops);
+		double const lock_free = best_of<megu::ThreadSafeArena>(n, ops);
+		std::printf("%8u %16.1f %16.1f%s\n", n, locked, lock_free, n > hw ? "  (oversubscribed)" : "");
+	}
+	return 0;
+}
@@ -38,4 +38,11 @@ namespace megu {
 		return pimpl_->dump_usage();
 	}
 
+	void GarbageCollector::SetHeapProfiler(HeapProfiler* profiler) {
+		pimpl_->set_profiler(profiler);
+	}
+	HeapProfiler* GarbageCollector::GetHeapProfiler()const {
+		return pimpl_->profiler();
+	}
+
 }//end megu
\ No newline at end of file
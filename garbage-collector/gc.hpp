@@ -2,6 +2,7 @@
 #include <memory>
 #include <string>
 #include <cstdio>
+#include <cstring>
 #if defined(_MSC_VER)
 #include <intrin.h>
 #endif
@@ -17,6 +18,7 @@ namespace megu {
 	using Word = uintptr_t;
 
 	struct GarbageCollectorImpl;
+	class HeapProfiler;
 
 	// !WARNING! sometimes this will NOT work on release builds because not all references are stored in the stack
 	//due to compiler optimizations
@@ -119,6 +121,10 @@ namespace megu {
 		void  FreeAll();
 		std::string DumpUsage()const;
 
+		//samples objects allocated from now on into profiler (see megu::HeapProfiler), null stops
+		void SetHeapProfiler(HeapProfiler* profiler);
+		HeapProfiler* GetHeapProfiler()const;
+
 		template<typename T, typename ...Args>
 		T* NewObject(Args&&...args) {
 			void(*dtor)(void*, std::size_t)noexcept = nullptr;
@@ -4,6 +4,7 @@
 #include <unordered_map>
 #include <iostream>
 #include <assert.h>
+#include "../arena/heap_profiler.hpp"
 
 namespace megu {
     
@@ -42,19 +43,16 @@ namespace megu {
     };
 
     struct Object {
-#ifndef _MSC_VER
-        constexpr 
-#endif
-            Object(
+        Object(
             std::size_t object_size,
             void(*dtor)(void*,std::size_t)noexcept,
             std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)
             :
             status_(GC_DEFAULT),
-            data_(alloc(object_size,std::max(__STDCPP_DEFAULT_NEW_ALIGNMENT__,align))),
+            data_(alloc(object_size,std::max<std::size_t>(__STDCPP_DEFAULT_NEW_ALIGNMENT__,align))),
             dtor_(dtor),
             size_(object_size),
-            alignment_(std::max(__STDCPP_DEFAULT_NEW_ALIGNMENT__,align)){}
+            alignment_(std::max<std::size_t>(__STDCPP_DEFAULT_NEW_ALIGNMENT__,align)){}
 
         ~Object() {
             destroy();
@@ -129,9 +127,6 @@ namespace megu {
         std::size_t alignment_;
         GCMark status_;
 
-#ifndef _MSC_VER
-        constexpr
-#endif
         static char* alloc(std::size_t v, std::size_t align) {
             return static_cast<char*>(::operator new(v, std::align_val_t(align)));
         }
@@ -159,6 +154,7 @@ namespace megu {
         void free(void* data) {
             auto it = gc_map_.find(data);
             if (it != gc_map_.end()) {
+                sampler_.on_free(data);
                 gc_map_.erase(it); 
             }
         }
@@ -167,9 +163,17 @@ namespace megu {
             auto obj = Object(nbytes, dtor, align);
             char* data = obj.data();
             gc_map_.insert({ data, std::move(obj) }); 
+            sampler_.on_alloc(data, nbytes);
             return data;
         }
 
+        void set_profiler(HeapProfiler* profiler)noexcept {
+            sampler_.set_profiler(profiler);
+        }
+        HeapProfiler* profiler()const noexcept {
+            return sampler_.profiler();
+        }
+
 
         void collect() {
             Word const* rsp = std::launder(reinterpret_cast<Word const*>(MEGU_GET_SP()));
@@ -180,17 +184,21 @@ namespace megu {
             else {
                 find_reachables(rsp_, rsp);
             }
-            std::erase_if(gc_map_, [this](auto && entry) {
-                Object& obj = std::get<1>(entry);
+            //by hand since std::erase_if only hands the predicate const entries
+            for (auto it = gc_map_.begin(); it != gc_map_.end();) {
+                Object& obj = it->second;
                 if (obj.mark() == GC_KEEP_ALIVE) {
-                    return false;
+                    ++it;
+                    continue;
                 }
                 if (obj.mark() == GC_REFERENCED) { 
                     obj.mark(GC_DEFAULT);   
-                    return false;
+                    ++it;
+                    continue;
                 }
-                return true;
-            });
+                sampler_.on_free(it->first);
+                it = gc_map_.erase(it);
+            }
         }
 
         std::string dump_usage()const {
@@ -208,6 +216,7 @@ namespace megu {
         }
 
         void free_all()noexcept {
+            sampler_.forget_since(0);
             gc_map_.clear();
         }
 
@@ -221,6 +230,7 @@ namespace megu {
     private:
         ObjectToChunkMap gc_map_; 
         Word const* rsp_;
+        detail::heap_sampler_t sampler_;
 
 
         void find_reachables(Word const* begin, Word const* end){